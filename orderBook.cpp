@@ -1,20 +1,31 @@
-// orderBook_multi.cpp
-// Multi-symbol interactive exchange simulator (Windows / PowerShell friendly)
+// orderBook.cpp
+// Multi-symbol exchange simulator on the core engine, one Orderbook per
+// symbol: interactive console (Windows / PowerShell friendly), a headless
+// multi-threaded load mode and a discrete-event agent simulation
 
 #include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <iostream>
-#include <list>
-#include <map>
 #include <thread>
 #include <vector>
 #include <algorithm>
 #include <iomanip>
-#include <deque>
 #include <unordered_map>
 #include <mutex>
+#include <functional>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <cstdio>
 #include <conio.h>   // _kbhit(), _getch() on Windows
+#include "orderBook_core.hpp"
+#include "orderBook_trace.hpp"
+#include "orderBook_des.hpp"
+#include "orderBook_agents.hpp"
+#include "orderBook_rng.hpp"
+#include "orderBook_histogram.hpp"
+#include "orderBook_symbols.hpp"
 
 using namespace std;
 
@@ -36,142 +47,144 @@ static inline uint64_t now_ns() {
 }
 
 // ---------- Core Types ----------
-enum class Side : uint8_t { Buy, Sell };
-enum class OrderType : uint8_t { GTC, IOC };
-using Price = int32_t;
-using Qty   = uint32_t;
-using Oid   = uint64_t;
-
+// Matching is orderBook_core's; the simulator adds tape events on top.
 struct TradeEvent {
-    Oid bidId{}, askId{};
+    OrderId bidId{}, askId{};
     Price px{};
-    Qty qty{};
+    Quantity qty{};
     uint64_t ts_ns{};
     Side aggressor;
 };
 
-// ---------- Orderbook (single symbol) ----------
-class Orderbook {
-    struct Order { Oid id; Side side; OrderType type; Price px; Qty rem; };
-    using Q = list<Order>;
-    map<Price, Q, greater<Price>> bids_;
-    map<Price, Q, less<Price>>    asks_;
-public:
-    vector<TradeEvent> add(Order o) {
-        vector<TradeEvent> out;
-
-        auto matchable = [&]() {
-            if (o.side == Side::Buy) return !asks_.empty() && o.px >= asks_.begin()->first;
-            return !bids_.empty() && o.px <= bids_.begin()->first;
-        };
-        auto enqueue = [&]() {
-            if (o.side == Side::Buy) bids_[o.px].push_back(o);
-            else                     asks_[o.px].push_back(o);
-        };
-
-        if (o.type == OrderType::IOC && !matchable()) return out;
-
-        if (o.side == Side::Buy) {
-            while (o.rem && !asks_.empty() && o.px >= asks_.begin()->first) {
-                auto apx = asks_.begin()->first;
-                auto& aq = asks_.begin()->second;
-                auto& top = aq.front();
-                Qty q = min(o.rem, top.rem);
-                o.rem -= q; top.rem -= q;
-                out.push_back({o.id, top.id, apx, q, now_ns(), Side::Buy});
-                if (top.rem == 0) { aq.pop_front(); if (aq.empty()) asks_.erase(apx); }
-                if (!o.rem) break;
-            }
-            if (o.rem && o.type == OrderType::GTC) enqueue();
-        } else {
-            while (o.rem && !bids_.empty() && o.px <= bids_.begin()->first) {
-                auto bpx = bids_.begin()->first;
-                auto& bq = bids_.begin()->second;
-                auto& top = bq.front();
-                Qty q = min(o.rem, top.rem);
-                o.rem -= q; top.rem -= q;
-                out.push_back({top.id, o.id, bpx, q, now_ns(), Side::Sell});
-                if (top.rem == 0) { bq.pop_front(); if (bq.empty()) bids_.erase(bpx); }
-                if (!o.rem) break;
-            }
-            if (o.rem && o.type == OrderType::GTC) enqueue();
-        }
-        return out;
-    }
-
-    void seedAsks(int levels = 10, int qty = 10) {
-        for (int i = 0; i < levels; ++i) {
-            Price px = (Price)(100 + i);
-            asks_[px].push_back({(Oid)(100000 + i), Side::Sell, OrderType::GTC, px, (Qty)qty});
-        }
-    }
-
-    Price bestBid() const { return bids_.empty() ? 0 : bids_.begin()->first; }
-    Price bestAsk() const { return asks_.empty() ? 0 : asks_.begin()->first; }
+// Core fills -> tape events; the print price is the resting order's
+static vector<TradeEvent> toTradeEvents(const Trades& fills, Side aggressor, uint64_t ts) {
+    vector<TradeEvent> out;
+    out.reserve(fills.size());
+    for (const Trade& f : fills)
+        out.push_back({f.bid.orderId, f.ask.orderId,
+                       aggressor == Side::Buy ? f.ask.price : f.bid.price, f.bid.qty, ts, aggressor});
+    return out;
+}
 
-    size_t restingOrders() const {
-        size_t total = 0;
-        for (auto& p : bids_) total += p.second.size();
-        for (auto& p : asks_) total += p.second.size();
-        return total;
-    }
-
-    vector<pair<Price, Qty>> topBids(size_t N=5) const {
-        vector<pair<Price, Qty>> res;
-        for (auto it = bids_.begin(); it != bids_.end() && res.size() < N; ++it) {
-            Qty sum = 0; for (auto& o : it->second) sum += o.rem;
-            res.emplace_back(it->first, sum);
-        }
-        return res;
-    }
-    vector<pair<Price, Qty>> topAsks(size_t N=5) const {
-        vector<pair<Price, Qty>> res;
-        for (auto it = asks_.begin(); it != asks_.end() && res.size() < N; ++it) {
-            Qty sum = 0; for (auto& o : it->second) sum += o.rem;
-            res.emplace_back(it->first, sum);
-        }
-        return res;
-    }
-};
+// Ids outside any flow's range, so seeded and manual orders never collide
+// with generated ones (the core rejects duplicate ids)
+static const OrderId kSeedIdBase = 1ULL << 62;
+static const OrderId kUserIdBase = kSeedIdBase + 1'000'000;
 
 // ---------- Per-symbol Market (book + tape + lock) ----------
+// Nothing is allocated for a market until its first order: the book is
+// lazy and the tape only grows on the first trade.
 struct Market {
+    SymbolId symId{0};         // registry id; also the trace symbol
+    bool seeded{false};        // demo liquidity added on first use
+    Price seedPx{100};         // best seeded ask
     Orderbook book;
-    deque<TradeEvent> tape;    // scrolling trade tape
+    vector<TradeEvent> tape;   // scrolling trade tape, newest first
     uint64_t tradeCount{0};
+    uint64_t rejects{0};       // refused by price bands or a halt
     mutex m;
 };
 static const size_t MAX_TAPE = 12;
 
+// ---------- Op recording (--record <trace>) ----------
+static TraceWriter gTrace;
+static mutex gTraceMu;
+
+static void seedAsksLocked(Market& mk, int levels, int qty);
+
+// Every inbound order goes through here so a run can be recorded exactly.
+// Caller holds mk.m.
+static vector<TradeEvent> submitLocked(Market& mk, OrderId id, Side s, OrderType t, Price px, Quantity q,
+                                       uint64_t ts = now_ns()) {
+    if (!mk.seeded) {
+        mk.seeded = true;
+        seedAsksLocked(mk, 15, 20);
+    }
+    if (gTrace.isOpen()) {
+        TraceRecord r{};
+        r.op = (uint8_t)(t == OrderType::GoodTillCancel ? TraceOp::Add : TraceOp::Ioc);
+        r.side = (s == Side::Buy) ? 0 : 1;
+        r.symbol = mk.symId;
+        r.px = px;
+        r.qty = q;
+        r.id = id;
+        lock_guard<mutex> g(gTraceMu);
+        gTrace.write(r);
+    }
+    mk.book.AdvanceTime(ts);
+    auto fills = mk.book.AddOrder(mk.book.MakeOrder(t, id, s, px, q));
+    Reject why = mk.book.LastReject();
+    if (why == Reject::PriceBand || why == Reject::Halted) ++mk.rejects;
+    return toTradeEvents(fills, s, ts);
+}
+
+static void seedAsksLocked(Market& mk, int levels, int qty) {
+    for (int i = 0; i < levels; ++i)
+        submitLocked(mk, kSeedIdBase + (OrderId)i, Side::Sell, OrderType::GoodTillCancel, (Price)(mk.seedPx + i), (Quantity)qty);
+}
+
 // ---------- Symbol Manager ----------
+// Demo instruments: books run in tick indices, these map them to prices
+static SymbolRegistry demoSymbols() {
+    SymbolRegistry reg;
+    reg.intern("AAPL",   InstrumentSpec{2, 1, 18000, 20000});     // 0.01 from 180.00
+    reg.intern("MSFT",   InstrumentSpec{2, 1, 41000, 43000});     // 0.01 from 410.00
+    reg.intern("BTCUSD", InstrumentSpec{1, 5, 670000, 690000});   // 0.5 from 67000.0
+    return reg;
+}
+
+// Markets live in one array indexed by registry id; names are only looked
+// up when symbols are loaded and printed.
 struct SymbolManager {
-    vector<string> symbols {"AAPL","MSFT","BTCUSD"};
-    unordered_map<string, unique_ptr<Market>> markets;
-    atomic<int> activeIdx{0}; // 0=AAPL, 1=MSFT, 2=BTCUSD
-
-    SymbolManager() {
-        for (auto& s : symbols) {
-            auto m = make_unique<Market>();
-            m->book.seedAsks(15, 20);
-            markets.emplace(s, std::move(m));
+    SymbolRegistry registry;
+    vector<Market> markets;
+    atomic<SymbolId> activeId{0};
+
+    explicit SymbolManager(SymbolRegistry reg = demoSymbols())
+        : registry(std::move(reg)), markets(registry.size()) {
+        for (SymbolId id = 0; id < markets.size(); ++id) markets[id].symId = id;
+    }
+
+    size_t size() const { return markets.size(); }
+    const string& name(SymbolId id) const { return registry.name(id); }
+
+    // Static band from each instrument's spec; dynamic band and breaker as
+    // given. Books with nothing to enforce are left without controls.
+    void applyControls(PriceControls pc) {
+        for (SymbolId id = 0; id < size(); ++id) {
+            int32_t levels = registry.spec(id).levels();
+            pc.staticLo = 1;
+            pc.staticHi = levels == INT32_MAX ? 0 : levels;
+            if (pc.staticHi || pc.dynamicTicks || pc.haltMoveTicks) markets[id].book.SetControls(pc);
         }
     }
 
-    string activeSymbol() const {
-        int idx = activeIdx.load(memory_order_relaxed);
-        idx = max(0, min(idx, (int)symbols.size()-1));
-        return symbols[(size_t)idx];
+    SymbolId active() const {
+        return min<SymbolId>(activeId.load(memory_order_relaxed), (SymbolId)size() - 1);
     }
-    Market& activeMarket() {
-        return *markets[activeSymbol()];
+    void select(SymbolId id) { if (id < size()) activeId.store(id); }
+    void step(int delta) {
+        int n = (int)size();
+        activeId.store((SymbolId)(((int)active() + delta % n + n) % n));
     }
 };
 
 // ---------- UI Printer (snapshot) ----------
-static void printMarketSnapshot(const string& sym, const Market& mk) {
+// Book prices are tick indices; 0 means no price on that side
+static string pxText(const InstrumentSpec& spec, Price px) {
+    return px ? spec.format((int32_t)px) : "-";
+}
+
+static string spreadText(const InstrumentSpec& spec, const Orderbook& book) {
+    Price bid = book.BestBid(), ask = book.BestAsk();
+    if (!bid || !ask) return "-";
+    return InstrumentSpec::formatFixed((int64_t)(ask - bid) * spec.tick, spec.scale);
+}
+
+static void printMarketSnapshot(const string& sym, const InstrumentSpec& spec, const Market& mk) {
     // Build snapshot while holding lock at call site
-    auto bids = mk.book.topBids();
-    auto asks = mk.book.topAsks();
+    auto bids = mk.book.TopBids();
+    auto asks = mk.book.TopAsks();
 
     cout << "\033[2J\033[H"; // clear screen
     cout << Color::CYAN << "=========== " << sym << " ORDER BOOK (Top 5) ===========" << Color::RESET << "\n";
@@ -181,10 +194,10 @@ static void printMarketSnapshot(const string& sym, const Market& mk) {
 
     size_t maxRows = max(bids.size(), asks.size());
     for (size_t i = 0; i < maxRows; ++i) {
-        string bidQty = (i < bids.size() ? to_string(bids[i].second) : "");
-        string bidPx  = (i < bids.size() ? to_string(bids[i].first)  : "");
-        string askPx  = (i < asks.size() ? to_string(asks[i].first)  : "");
-        string askQty = (i < asks.size() ? to_string(asks[i].second) : "");
+        string bidQty = (i < bids.size() ? to_string(bids[i].qty) : "");
+        string bidPx  = (i < bids.size() ? pxText(spec, bids[i].price) : "");
+        string askPx  = (i < asks.size() ? pxText(spec, asks[i].price) : "");
+        string askQty = (i < asks.size() ? to_string(asks[i].qty) : "");
         cout << Color::GREEN << left << setw(15) << bidQty << setw(10) << bidPx << Color::RESET
              << " | "
              << Color::RED   << setw(10) << askPx  << setw(15) << askQty << Color::RESET << "\n";
@@ -193,12 +206,14 @@ static void printMarketSnapshot(const string& sym, const Market& mk) {
     cout << Color::GRAY << "---------------------------------------------------------" << Color::RESET << "\n";
     cout << Color::CYAN
          << "Trades=" << mk.tradeCount
-         << "  Resting=" << mk.book.restingOrders()
-         << "  Top=(" << mk.book.bestBid() << "," << mk.book.bestAsk() << ")"
-         << "  Spread=" << (mk.book.bestAsk() - mk.book.bestBid())
+         << "  Resting=" << mk.book.size()
+         << "  Top=(" << pxText(spec, mk.book.BestBid()) << "," << pxText(spec, mk.book.BestAsk()) << ")"
+         << "  Spread=" << spreadText(spec, mk.book)
+         << "  Rejects=" << mk.rejects
+         << (mk.book.Halted() ? "  HALTED" : "")
          << Color::RESET << "\n";
     cout << Color::YELLOW
-         << "Commands: [1]AAPL  [2]MSFT  [3]BTCUSD   [B]uy  [S]ell  [C]ancel  [Q]uit\n"
+         << "Commands: [1-9]Symbol  [N]ext  [P]rev   [B]uy  [S]ell  [C]ancel  [Q]uit\n"
          << Color::RESET;
 
     // Tape
@@ -207,7 +222,7 @@ static void printMarketSnapshot(const string& sym, const Market& mk) {
     for (auto& t : mk.tape) {
         const string& col = (t.aggressor == Side::Buy ? Color::GREEN : Color::RED);
         cout << col << setw(6) << (t.aggressor == Side::Buy ? "BUY" : "SELL") << Color::RESET
-             << " @ " << setw(5) << t.px
+             << " @ " << setw(9) << pxText(spec, t.px)
              << " x " << setw(5) << t.qty
              << Color::GRAY << "  id(" << t.bidId << "," << t.askId << ")" << Color::RESET << "\n";
     }
@@ -217,7 +232,7 @@ static void printMarketSnapshot(const string& sym, const Market& mk) {
 // ---------- Tape helper ----------
 static inline void addTradesToTapeLocked(Market& mk, const vector<TradeEvent>& trades) {
     for (auto& t : trades) {
-        mk.tape.push_front(t);
+        mk.tape.insert(mk.tape.begin(), t);
         if (mk.tape.size() > MAX_TAPE) mk.tape.pop_back();
     }
 }
@@ -225,12 +240,12 @@ static inline void addTradesToTapeLocked(Market& mk, const vector<TradeEvent>& t
 // ---------- Display Thread (refresh current symbol) ----------
 static void displayLoop(SymbolManager& sm, atomic<bool>& runFlag) {
     while (runFlag) {
-        string sym = sm.activeSymbol();
+        SymbolId id = sm.active();
         {
             // Snapshot under lock
-            auto& mk = *sm.markets[sym];
+            auto& mk = sm.markets[id];
             lock_guard<mutex> g(mk.m);
-            printMarketSnapshot(sym, mk);
+            printMarketSnapshot(sm.name(id), sm.registry.spec(id), mk);
         }
         this_thread::sleep_for(chrono::milliseconds(500));
     }
@@ -238,33 +253,32 @@ static void displayLoop(SymbolManager& sm, atomic<bool>& runFlag) {
 
 // ---------- Input Thread (switch symbols + manual orders) ----------
 static void inputLoop(SymbolManager& sm, atomic<bool>& runFlag) {
-    static uint64_t userId = 900000;
+    static uint64_t userId = kUserIdBase;
     while (runFlag) {
         if (_kbhit()) {
             char ch = toupper(_getch());
             if (ch == 'Q') { runFlag = false; break; }
-            else if (ch == '1') sm.activeIdx.store(0);
-            else if (ch == '2') sm.activeIdx.store(1);
-            else if (ch == '3') sm.activeIdx.store(2);
+            else if (ch >= '1' && ch <= '9') sm.select((SymbolId)(ch - '1'));
+            else if (ch == 'N') sm.step(1);
+            else if (ch == 'P') sm.step(-1);
             else if (ch == 'B' || ch == 'S' || ch == 'C') {
-                string sym = sm.activeSymbol();
-                auto& mk = *sm.markets[sym];
+                auto& mk = sm.markets[sm.active()];
                 lock_guard<mutex> g(mk.m);
 
                 vector<TradeEvent> trades;
                 if (ch == 'B') {
-                    Price px = mk.book.bestAsk() ? (Price)(mk.book.bestAsk() - 2) : (Price)99;
-                    trades = mk.book.add({++userId, Side::Buy, OrderType::GTC, px, (Qty)10});
+                    Price px = mk.book.BestAsk() ? (Price)(mk.book.BestAsk() - 2) : (Price)99;
+                    trades = submitLocked(mk, ++userId, Side::Buy, OrderType::GoodTillCancel, px, (Quantity)10);
                     for (auto& t : trades) t.aggressor = Side::Buy; // show user side on tape
                 }
                 else if (ch == 'S') {
-                    Price px = mk.book.bestBid() ? (Price)(mk.book.bestBid() + 5) : (Price)110; // make it rest
-                    trades = mk.book.add({++userId, Side::Sell, OrderType::GTC, px, (Qty)10});
+                    Price px = mk.book.BestBid() ? (Price)(mk.book.BestBid() + 5) : (Price)110; // make it rest
+                    trades = submitLocked(mk, ++userId, Side::Sell, OrderType::GoodTillCancel, px, (Quantity)10);
                     for (auto& t : trades) t.aggressor = Side::Sell;
                 }
                 else if (ch == 'C') {
-                    Price a = mk.book.bestAsk();
-                    if (a) trades = mk.book.add({++userId, Side::Buy, OrderType::IOC, a, (Qty)1});
+                    Price a = mk.book.BestAsk();
+                    if (a) trades = submitLocked(mk, ++userId, Side::Buy, OrderType::FillAndKill, a, (Quantity)1);
                     // (simple IOC poke to simulate a cancel-take)
                 }
 
@@ -276,63 +290,427 @@ static void inputLoop(SymbolManager& sm, atomic<bool>& runFlag) {
     }
 }
 
-// ---------- Per-symbol market simulation threads ----------
-static void marketSimLoop(SymbolManager& sm, const string sym, atomic<bool>& runFlag, int seedSkew=0) {
+// ---------- Per-symbol market flow ----------
+// One step of a symbol's demo flow; shared by the real-time threads and the
+// discrete-event mode so both produce the same order sequence.
+struct SimFlow {
     uint64_t id = 1;
-    bool flip = (seedSkew % 2) != 0;
-    auto& mk = *sm.markets[sym];
+    bool flip = false;
+    int seedSkew = 0;
+    SimFlow(int skew = 0, uint64_t firstId = 1) : id(firstId), flip((skew % 2) != 0), seedSkew(skew) {}
+};
 
-    while (runFlag) {
-        Side s = (flip ? Side::Sell : Side::Buy);
-        flip = !flip;
+static size_t simStep(Market& mk, SimFlow& f, uint64_t ts) {
+    Side s = (f.flip ? Side::Sell : Side::Buy);
+    f.flip = !f.flip;
 
-        vector<TradeEvent> trades;
-        {
+    lock_guard<mutex> g(mk.m);
+    Price px = (Price)(100 + (f.id % 30) + f.seedSkew); // different centers per symbol
+    auto trades = submitLocked(mk, f.id++, s, OrderType::FillAndKill, px, (Quantity)10, ts);
+    mk.tradeCount += trades.size();
+    addTradesToTapeLocked(mk, trades);
+    return trades.size();
+}
+
+// ---------- Flow agents ----------
+// Each flow is a coroutine on an AgentScheduler, so one thread carries any
+// number of them. Fixed pacing on the wall clock; with a jitter source the
+// gap is exponential around the same mean (discrete-event runs).
+static AgentTask flowAgent(AgentScheduler& sched, Market& mk, SimFlow flow, Xoshiro256* jitter) {
+    const double meanNs = (25 + (flow.seedSkew % 10)) * 1e6; // slight variation per symbol
+    for (;;) {
+        simStep(mk, flow, sched.now());
+        co_await sched.sleep(jitter ? 1 + (uint64_t)jitter->exponential(meanNs) : (uint64_t)meanNs);
+    }
+}
+
+// different "centers" for symbols so they don't look identical
+static const int kSeedSkews[] = {0, 3, 8};
+
+static void spawnFlows(AgentScheduler& sched, SymbolManager& sm, int agentsPerSymbol, Xoshiro256* jitter) {
+    for (SymbolId id = 0; id < sm.size(); ++id)
+        for (int k = 0; k < agentsPerSymbol; ++k)
+            sched.spawn(flowAgent(sched, sm.markets[id],
+                                  SimFlow(kSeedSkews[id % 3], 1 + (uint64_t)k * 1'000'000'000ULL), jitter));
+}
+
+// ---------- Discrete-event mode (--des <hours>) ----------
+// Same per-symbol flows, scheduled on a virtual clock with seeded
+// exponential inter-arrivals (mean = the real-time pacing), run as fast
+// as the CPU allows. Identical seed => identical books and tapes.
+static void runDiscreteEventSim(SymbolManager& sm, double hours, uint64_t seed, int agentsPerSymbol) {
+    const uint64_t horizon = (uint64_t)(hours * 3600e9);
+
+    DiscreteEventSim des;
+    AgentScheduler sched(des);
+    Xoshiro256 rng(seed);
+    spawnFlows(sched, sm, agentsPerSymbol, &rng);
+
+    auto t0 = chrono::steady_clock::now();
+    des.runUntil(horizon);
+    double wall = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    // Fingerprint of the final state, to compare runs
+    uint64_t h = 1469598103934665603ULL;
+    auto mix = [&](uint64_t v) { h = (h ^ v) * 1099511628211ULL; };
+    for (auto& mk : sm.markets) {
+        mix(mk.tradeCount);
+        mix(mk.book.size());
+        for (auto& t : mk.tape) { mix(t.ts_ns); mix((uint64_t)t.px); mix(t.bidId); mix(t.askId); }
+    }
+
+    cout << fixed << setprecision(2);
+    cout << "=== DISCRETE-EVENT RUN ===\n";
+    cout << "Simulated      : " << hours << " h (seed " << seed << ", "
+         << sched.liveAgents() << " agents)\n";
+    cout << "Events         : " << des.processed() << "\n";
+    cout << "Wall time      : " << wall << " s (" << (hours * 3600.0 / max(wall, 1e-9)) << "x real time)\n";
+    cout << "Fingerprint    : " << hex << h << dec << "\n";
+}
+
+// ---------- Final stats ----------
+static void printSummary(SymbolManager& sm, size_t maxSymbols = SIZE_MAX) {
+    cout << "\n=== FINAL SUMMARY ===\n";
+    for (SymbolId id = 0; id < sm.size() && id < maxSymbols; ++id) {
+        auto& mk = sm.markets[id];
+        lock_guard<mutex> g(mk.m);
+        const InstrumentSpec& spec = sm.registry.spec(id);
+        cout << sm.name(id) << ": trades=" << mk.tradeCount
+             << " resting=" << mk.book.size()
+             << " top=(" << pxText(spec, mk.book.BestBid()) << "," << pxText(spec, mk.book.BestAsk()) << ")"
+             << " spread=" << spreadText(spec, mk.book)
+             << " rejects=" << mk.rejects << (mk.book.Halted() ? " halted" : "") << "\n";
+    }
+    if (sm.size() > maxSymbols)
+        cout << "... " << (sm.size() - maxSymbols) << " more symbols\n";
+    cout << "======================\n";
+    if (gTrace.isOpen()) {
+        cout << "Recorded " << gTrace.count() << " ops\n";
+        gTrace.close();
+    }
+}
+
+// ---------- Headless load mode (--headless <config>) ----------
+// Drives every market from worker threads at configured message rates with
+// no terminal UI, while a snapshot thread takes the same top-of-book
+// snapshots as the display. Config: one "SYMBOL RATE [CENTER]" per line,
+// RATE in msgs/s (0 = as fast as possible), CENTER an instrument price the
+// flow quotes around; '#' starts a comment.
+struct HeadlessSymbol {
+    string name;
+    double rate;
+    string centerText;   // as written; normalized once the registry is known
+    Price center = 0;    // tick index, 0 = default
+};
+
+// Turns each CENTER into a tick index of its instrument
+static void normalizeCenters(vector<HeadlessSymbol>& cfg, const SymbolRegistry& reg) {
+    for (auto& c : cfg) {
+        if (c.centerText.empty()) continue;
+        const InstrumentSpec& spec = reg.spec(reg.find(c.name));
+        int64_t px = 0;
+        int32_t ticks = 0;
+        if (!InstrumentSpec::parseFixed(c.centerText, spec.scale, px) || !spec.toTicks(px, ticks))
+            throw runtime_error(c.name + ": center " + c.centerText + " is off the tick grid or outside the band");
+        if (ticks <= 5 || ticks > spec.levels() - 5)   // loadStep quotes up to 5 ticks either side
+            throw runtime_error(c.name + ": center " + c.centerText + " is too close to the band edge");
+        c.center = (Price)ticks;
+    }
+}
+
+static vector<HeadlessSymbol> loadHeadlessConfig(const string& path) {
+    ifstream in(path);
+    if (!in) throw runtime_error("cannot open config " + path);
+    vector<HeadlessSymbol> out;
+    unordered_map<string, size_t> seen;
+    string line;
+    for (size_t lineNo = 1; getline(in, line); ++lineNo) {
+        line = line.substr(0, line.find('#'));
+        istringstream ss(line);
+        HeadlessSymbol s{};
+        if (!(ss >> s.name)) continue;
+        if (!(ss >> s.rate) || s.rate < 0)
+            throw runtime_error(path + ":" + to_string(lineNo) + ": expected SYMBOL RATE [CENTER]");
+        ss >> s.centerText;
+        if (!seen.emplace(s.name, lineNo).second)
+            throw runtime_error(path + ":" + to_string(lineNo) + ": duplicate symbol " + s.name);
+        out.push_back(s);
+    }
+    if (out.empty()) throw runtime_error(path + ": no symbols");
+    return out;
+}
+
+// Random passive adds around a fixed center, and IOCs two ticks through
+// the touch of equal size, so each book churns without growing.
+struct LoadFlow {
+    Market* mk;
+    double rate;
+    Price center;
+    Xoshiro256 rng;
+    uint64_t nextId;
+    uint64_t sent = 0;
+};
+
+static size_t loadStep(LoadFlow& f) {
+    Side s = f.rng.below(2) ? Side::Sell : Side::Buy;
+    bool passive = f.rng.below(2) == 0;
+    Price off = (Price)(1 + f.rng.below(5));
+
+    Market& mk = *f.mk;
+    lock_guard<mutex> g(mk.m);
+    vector<TradeEvent> trades;
+    if (passive) {
+        Price px = s == Side::Buy ? f.center - off : f.center + off;
+        trades = submitLocked(mk, f.nextId++, s, OrderType::GoodTillCancel, px, (Quantity)10);
+    } else {
+        Price touch = s == Side::Buy ? mk.book.BestAsk() : mk.book.BestBid();
+        if (!touch) touch = f.center;
+        Price px = s == Side::Buy ? touch + 2 : touch - 2;
+        trades = submitLocked(mk, f.nextId++, s, OrderType::FillAndKill, px, (Quantity)10);
+    }
+    mk.tradeCount += trades.size();
+    addTradesToTapeLocked(mk, trades);
+    return trades.size();
+}
+
+// Per-thread counters; the worker folds its private histogram in every few
+// thousand messages so the reporter never touches the hot path.
+struct LoadWorkerStats {
+    mutex mu;
+    LatencyHistogram window;
+    uint64_t msgs = 0;
+    uint64_t trades = 0;
+};
+
+static void loadWorker(vector<LoadFlow>& flows, LoadWorkerStats& st, const atomic<bool>& runFlag) {
+    const size_t kBurst = 64;       // max messages per symbol per pass
+    const size_t kFlushEvery = 4096;
+    LatencyHistogram local;
+    uint64_t msgs = 0, trades = 0;
+    auto flush = [&] {
+        lock_guard<mutex> g(st.mu);
+        st.window.merge(local);
+        st.msgs += msgs;
+        st.trades += trades;
+        local.reset();
+        msgs = trades = 0;
+    };
+
+    const uint64_t t0 = now_ns();
+    while (runFlag.load(memory_order_relaxed)) {
+        double elapsed = (double)(now_ns() - t0) * 1e-9;
+        size_t passSent = 0;
+        for (auto& f : flows) {
+            size_t n = kBurst;
+            if (f.rate > 0) {
+                double due = elapsed * f.rate - (double)f.sent;
+                n = due < 1 ? 0 : min(kBurst, (size_t)due);
+            }
+            for (size_t i = 0; i < n; ++i) {
+                uint64_t a = now_ns();
+                trades += loadStep(f);
+                local.add(now_ns() - a);
+            }
+            f.sent += n;
+            msgs += n;
+            passSent += n;
+        }
+        if (msgs >= kFlushEvery) flush();
+        if (!passSent) this_thread::sleep_for(chrono::microseconds(50));
+    }
+    flush();
+}
+
+// Same cadence and locking as displayLoop, minus the printing
+static void snapshotLoop(SymbolManager& sm, int periodMs, atomic<uint64_t>& taken,
+                         const atomic<bool>& runFlag) {
+    while (runFlag) {
+        for (auto& mk : sm.markets) {
             lock_guard<mutex> g(mk.m);
-            Price px = (Price)(100 + (id % 30) + seedSkew); // different centers per symbol
-            trades = mk.book.add({id++, s, OrderType::IOC, px, (Qty)10});
-            mk.tradeCount += trades.size();
-            addTradesToTapeLocked(mk, trades);
+            auto bids = mk.book.TopBids();
+            auto asks = mk.book.TopAsks();
+            taken.fetch_add(1, memory_order_relaxed);
+        }
+        this_thread::sleep_for(chrono::milliseconds(periodMs));
+    }
+}
+
+static void runHeadless(SymbolManager& sm, const vector<HeadlessSymbol>& cfg, double seconds,
+                        unsigned nThreads, double reportSec, int snapshotMs, uint64_t seed) {
+    nThreads = (unsigned)min<size_t>(max(1u, nThreads), cfg.size());
+
+    // Symbols dealt round-robin to workers; each symbol is driven by one thread
+    vector<vector<LoadFlow>> flows(nThreads);
+    for (size_t i = 0; i < cfg.size(); ++i) {
+        Market& mk = sm.markets[sm.registry.find(cfg[i].name)];
+        Price center = cfg[i].center ? cfg[i].center : (Price)(100 + 10 * (i % 50));
+        mk.seedPx = center + 1;   // seeded asks start at the flow's touch
+        flows[i % nThreads].push_back(LoadFlow{&mk, cfg[i].rate, center, Xoshiro256(seed + i), 1'000'000});
+    }
+    double targetRate = 0;
+    bool unthrottled = false;
+    for (auto& c : cfg) { targetRate += c.rate; unthrottled |= c.rate == 0; }
+
+    cout << "=== HEADLESS LOAD ===\n";
+    cout << cfg.size() << " symbols on " << nThreads << " worker thread(s), target ";
+    if (unthrottled) cout << "unthrottled";
+    else cout << fixed << setprecision(0) << targetRate << " msgs/s";
+    cout << ", " << seconds << " s\n";
+
+    atomic<bool> runFlag{true};
+    atomic<uint64_t> snapshots{0};
+    vector<LoadWorkerStats> stats(nThreads);
+    vector<thread> workers;
+    for (unsigned t = 0; t < nThreads; ++t)
+        workers.emplace_back(loadWorker, ref(flows[t]), ref(stats[t]), cref(runFlag));
+    thread tSnap(snapshotLoop, ref(sm), snapshotMs, ref(snapshots), cref(runFlag));
+
+    // Periodic summaries of the last interval, then a whole-run line
+    LatencyHistogram total;
+    uint64_t totalMsgs = 0, totalTrades = 0;
+    const uint64_t start = now_ns();
+    const uint64_t end = start + (uint64_t)(seconds * 1e9);
+    uint64_t last = start;
+    cout << fixed << setprecision(2);
+    while (last < end) {
+        uint64_t next = min(end, last + (uint64_t)(reportSec * 1e9));
+        this_thread::sleep_for(chrono::nanoseconds(next - min(next, now_ns())));
+        if (now_ns() >= end) runFlag = false;
+
+        LatencyHistogram window;
+        uint64_t msgs = 0, trades = 0;
+        for (auto& st : stats) {
+            lock_guard<mutex> g(st.mu);
+            window.merge(st.window);
+            msgs += st.msgs;
+            trades += st.trades;
+            st.window.reset();
+            st.msgs = st.trades = 0;
         }
-        this_thread::sleep_for(chrono::milliseconds(25 + (seedSkew % 10))); // slight variation per symbol
+        uint64_t t = now_ns();
+        double dt = (double)(t - last) * 1e-9;
+        last = t;
+        total.merge(window);
+        totalMsgs += msgs;
+        totalTrades += trades;
+        cout << "[" << setw(7) << (double)(t - start) * 1e-9 << "s] "
+             << setw(8) << (double)msgs / dt / 1e6 << " M msgs/s  trades/s=" << (uint64_t)(trades / dt)
+             << "  p50=" << window.percentile(0.50) << "ns p99=" << window.percentile(0.99)
+             << "ns p99.9=" << window.percentile(0.999) << "ns max=" << window.maxNs << "ns\n";
+    }
+    runFlag = false;
+    for (auto& w : workers) w.join();
+    tSnap.join();
+    for (auto& st : stats) {        // messages sent after the last report
+        total.merge(st.window);
+        totalMsgs += st.msgs;
+        totalTrades += st.trades;
     }
+
+    double wall = (double)(now_ns() - start) * 1e-9;
+    cout << "Total          : " << totalMsgs << " msgs (" << (double)totalMsgs / wall / 1e6 << " M/s), "
+         << totalTrades << " trades, " << snapshots.load() << " snapshots\n";
+    cout << "Latency        : avg=" << total.avg() << "ns p50=" << total.percentile(0.50)
+         << "ns p99=" << total.percentile(0.99) << "ns p99.9=" << total.percentile(0.999)
+         << "ns max=" << total.maxNs << "ns\n";
 }
 
 // ---------- Main ----------
-int main() {
+// Usage: orderBook [--symbols <file>] [--record <trace>] [--agents <per-symbol>] [--des <hours> [--seed <n>]]
+//        orderBook --headless <config> [--seconds <s>] [--threads <n>] [--report <s>] [--snapshot-ms <ms>]
+//        either mode: [--band <ticks>] [--breaker <ticks>[,<window-ms>[,<halt-ms>]]]
+int main(int argc, char** argv) {
+    double desHours = 0;
+    uint64_t seed = 1;
+    int agentsPerSymbol = 1;
+    string headlessConfig, symbolFile;
+    double headlessSec = 10, reportSec = 1;
+    unsigned loadThreads = thread::hardware_concurrency();
+    int snapshotMs = 500;
+    PriceControls controls;
+    for (int i = 1; i + 1 < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--record" && !gTrace.open(argv[++i])) {
+            cerr << "cannot open trace file " << argv[i] << "\n";
+            return 1;
+        }
+        else if (arg == "--des") desHours = stod(argv[++i]);
+        else if (arg == "--seed") seed = stoull(argv[++i]);
+        else if (arg == "--agents") agentsPerSymbol = max(1, stoi(argv[++i]));
+        else if (arg == "--headless") headlessConfig = argv[++i];
+        else if (arg == "--seconds") headlessSec = stod(argv[++i]);
+        else if (arg == "--threads") loadThreads = (unsigned)stoul(argv[++i]);
+        else if (arg == "--report") reportSec = max(0.1, stod(argv[++i]));
+        else if (arg == "--snapshot-ms") snapshotMs = max(1, stoi(argv[++i]));
+        else if (arg == "--symbols") symbolFile = argv[++i];
+        else if (arg == "--band") controls.dynamicTicks = stoi(argv[++i]);
+        else if (arg == "--breaker") {
+            // TICKS[,WINDOW_MS[,HALT_MS]]
+            double windowMs = 1000, haltMs = 5000;
+            sscanf(argv[++i], "%d,%lf,%lf", &controls.haltMoveTicks, &windowMs, &haltMs);
+            controls.haltWindowNs = (uint64_t)(windowMs * 1e6);
+            controls.haltNs = (uint64_t)(haltMs * 1e6);
+        }
+    }
+
+    // Symbols: reference-data file, else the headless config, else the demo three
+    SymbolRegistry reg = demoSymbols();
+    vector<HeadlessSymbol> cfg;
+    try {
+        if (!symbolFile.empty()) reg = loadSymbolFile(symbolFile);
+        if (!headlessConfig.empty()) {
+            cfg = loadHeadlessConfig(headlessConfig);
+            if (symbolFile.empty()) {
+                reg = SymbolRegistry();
+                for (auto& c : cfg) reg.intern(c.name);
+            }
+            for (auto& c : cfg)
+                if (reg.find(c.name) == kNoSymbol)
+                    throw runtime_error(headlessConfig + ": " + c.name + " is not in " + symbolFile);
+            normalizeCenters(cfg, reg);
+        }
+        if (reg.size() == 0) throw runtime_error("no symbols");
+        if (gTrace.isOpen() && reg.size() > 0x10000)
+            throw runtime_error("trace records hold 16-bit symbol ids; too many symbols to record");
+    } catch (const exception& e) {
+        cerr << e.what() << "\n";
+        return 1;
+    }
+
     // Use Windows Terminal / PowerShell for ANSI colors
-    SymbolManager sm;
+    SymbolManager sm(std::move(reg));
+    sm.applyControls(controls);
+
+    if (!headlessConfig.empty()) {
+        runHeadless(sm, cfg, headlessSec, loadThreads, reportSec, snapshotMs, seed);
+        printSummary(sm, 20);
+        return 0;
+    }
+
+    if (desHours > 0) {
+        runDiscreteEventSim(sm, desHours, seed, agentsPerSymbol);
+        printSummary(sm);
+        return 0;
+    }
+
     atomic<bool> runFlag{true};
 
-    // Threads: display + input + one marketSim per symbol
+    // Threads: display + input + one scheduler carrying every flow agent
+    AgentScheduler sched;
+    spawnFlows(sched, sm, agentsPerSymbol, nullptr);
+
     thread tDisp(displayLoop, ref(sm), ref(runFlag));
     thread tIn(inputLoop, ref(sm), ref(runFlag));
-
-    vector<thread> sims;
-    // different "centers" for symbols so they don't look identical
-    sims.emplace_back(marketSimLoop, ref(sm), string("AAPL"),  ref(runFlag), 0);
-    sims.emplace_back(marketSimLoop, ref(sm), string("MSFT"),  ref(runFlag), 3);
-    sims.emplace_back(marketSimLoop, ref(sm), string("BTCUSD"),ref(runFlag), 8);
+    thread tSim([&] { sched.runWall(runFlag); });
 
     // Wait for quit
     tIn.join();
     runFlag = false;
 
     // Join all threads
-    for (auto& th : sims) th.join();
+    tSim.join();
     tDisp.join();
 
-    // Final stats
-    cout << "\n=== FINAL SUMMARY ===\n";
-    for (size_t i = 0; i < sm.symbols.size(); ++i) {
-        const string& sym = sm.symbols[i];
-        auto& mk = *sm.markets[sym];
-        lock_guard<mutex> g(mk.m);
-        cout << sym << ": trades=" << mk.tradeCount
-             << " resting=" << mk.book.restingOrders()
-             << " top=(" << mk.book.bestBid() << "," << mk.book.bestAsk() << ")"
-             << " spread=" << (mk.book.bestAsk() - mk.book.bestBid()) << "\n";
-    }
-    cout << "======================\n";
+    printSummary(sm);
     return 0;
 }
@@ -0,0 +1,322 @@
+#include "orderBook_agentlib.hpp"
+#include <algorithm>
+#include <cmath>
+
+// -------------------- Venue --------------------
+SimVenue::SimVenue(AgentScheduler& sched, size_t nSymbols, Price refPx)
+    : sched_(sched), books_(nSymbols), refPx_(refPx) {
+    for (auto& b : books_) {
+        b.ob = std::make_unique<Orderbook>();
+        b.quoteSig = std::make_unique<Signal>(sched);
+    }
+}
+
+void SimVenue::enableRisk(uint32_t firstAgent, size_t nAgents, const RiskLimits& limits) {
+    risk_ = std::make_unique<RiskBook>(nAgents, limits);
+    accountBase_ = firstAgent;
+    sessionBooks_.assign(nAgents + 1, {});
+    for (auto& b : books_) b.ob->SetRisk(risk_.get());
+}
+
+void SimVenue::setSelfTradePrevention(StpMode mode) {
+    for (auto& b : books_) b.ob->SetSelfTradePrevention(mode);
+}
+
+// Orders self-trade prevention removed are no longer live
+void SimVenue::forget(const Orderbook& ob) {
+    for (OrderId id : ob.LastCancelled()) {
+        ++stats_.stpCancels;
+        owners_.erase(id);
+    }
+}
+
+// Counts risk rejects; an IOC with nothing to hit is not one
+bool SimVenue::refused(const Orderbook& ob) {
+    Reject why = ob.LastReject();
+    if (why == Reject::None || why == Reject::NoLiquidity) return false;
+    ++stats_.riskRejects;
+    return true;
+}
+
+OrderId SimVenue::limit(AgentContext& a, uint32_t sym, Side side, Price px, Quantity qty) {
+    OrderId id = nextId_++;
+    owners_[id] = Owner{&a, qty};
+    ++stats_.adds;
+    trace(TraceOp::Add, sym, side, id, px, qty);
+    Orderbook& ob = *books_[sym].ob;
+    route(sym, id, ob.AddOrder(ob.MakeOrder(OrderType::GoodTillCancel, id, side, px, qty, account(a))));
+    if (refused(ob)) owners_.erase(id);
+    else if (AccountId acct = account(a); acct && owners_.count(id)) {
+        auto& syms = sessionBooks_[acct];
+        if (std::find(syms.begin(), syms.end(), sym) == syms.end()) syms.push_back(sym);
+    }
+    forget(ob);
+    publish(sym);
+    return id;
+}
+
+Quantity SimVenue::ioc(AgentContext& a, uint32_t sym, Side side, Price px, Quantity qty) {
+    OrderId id = nextId_++;
+    owners_[id] = Owner{&a, qty};
+    ++stats_.iocs;
+    trace(TraceOp::Ioc, sym, side, id, px, qty);
+    Orderbook& ob = *books_[sym].ob;
+    route(sym, id, ob.AddOrder(ob.MakeOrder(OrderType::FillAndKill, id, side, px, qty, account(a))));
+    refused(ob);
+    Quantity filled = qty;
+    auto it = owners_.find(id);
+    if (it != owners_.end()) {       // unfilled remainder was killed by the engine
+        filled = qty - it->second.remaining;
+        owners_.erase(it);
+    }
+    forget(ob);
+    publish(sym);
+    return filled;
+}
+
+void SimVenue::cancel(AgentContext&, uint32_t sym, OrderId id) {
+    // Sent even if the order already filled, as real flow races its fills
+    ++stats_.cancels;
+    trace(TraceOp::Cancel, sym, Side::Buy, id, 0, 0);
+    books_[sym].ob->CancelOrder(id);
+    owners_.erase(id);
+    publish(sym);
+}
+
+size_t SimVenue::cancelAll(AgentContext& a, uint32_t sym) {
+    return pulled(sym, books_[sym].ob->CancelAllForAccount(account(a)));
+}
+
+size_t SimVenue::cancelAll(AgentContext& a, uint32_t sym, Side side) {
+    return pulled(sym, books_[sym].ob->CancelAllForAccount(account(a), side));
+}
+
+size_t SimVenue::disconnect(AgentContext& a) {
+    AccountId acct = account(a);
+    if (!acct) return 0;
+    size_t n = 0;
+    for (uint32_t sym : sessionBooks_[acct]) n += cancelAll(a, sym);
+    sessionBooks_[acct].clear();
+    ++stats_.disconnects;
+    stats_.disconnectCancels += n;
+    return n;
+}
+
+// Recorded as individual cancels so traces replay on any engine
+size_t SimVenue::pulled(uint32_t sym, const std::vector<OrderId>& ids) {
+    for (OrderId id : ids) {
+        ++stats_.cancels;
+        trace(TraceOp::Cancel, sym, Side::Buy, id, 0, 0);
+        owners_.erase(id);
+    }
+    publish(sym);
+    return ids.size();
+}
+
+void SimVenue::modify(AgentContext&, uint32_t sym, OrderId id, Price px, Quantity qty) {
+    ++stats_.modifies;
+    trace(TraceOp::Modify, sym, Side::Buy, id, px, qty);
+    Orderbook& ob = *books_[sym].ob;
+    Trades fills = ob.ModifyOrder(id, px, qty);
+    if (!refused(ob)) {                // a refused amend leaves the order as it was
+        auto it = owners_.find(id);
+        if (it != owners_.end()) it->second.remaining = qty;
+    }
+    route(sym, id, fills);
+    forget(ob);
+    publish(sym);
+}
+
+Price SimVenue::mid(uint32_t sym) const {
+    const Book& b = books_[sym];
+    Price bid = b.ob->BestBid(), ask = b.ob->BestAsk();
+    if (bid && ask) return (bid + ask) / 2;
+    if (bid || ask) return bid ? bid : ask;
+    return b.lastTrade ? b.lastTrade : refPx_;
+}
+
+// Trades print at the resting order's price, as in the engine; the
+// incoming order is `aggressor`, so the resting side is the other one
+void SimVenue::route(uint32_t sym, OrderId aggressor, const Trades& trades) {
+    for (const Trade& t : trades) {
+        ++stats_.trades;
+        stats_.volume += t.bid.qty;
+        Price px = t.bid.orderId == aggressor ? t.ask.price : t.bid.price;
+        books_[sym].lastTrade = px;
+        fill(t.bid.orderId, px, t.bid.qty, +1);
+        fill(t.ask.orderId, px, t.ask.qty, -1);
+    }
+}
+
+void SimVenue::fill(OrderId id, Price px, Quantity q, int sign) {
+    auto it = owners_.find(id);
+    if (it == owners_.end()) return;
+    AgentContext& a = *it->second.agent;
+    a.position += sign * (int64_t)q;
+    a.filledQty += q;
+    if (a.wantsFills) a.fills.post(FillEvent{id, px, q, sched_.now()});
+    if (it->second.remaining <= q) owners_.erase(it);
+    else it->second.remaining -= q;
+}
+
+void SimVenue::publish(uint32_t sym) {
+    Book& b = books_[sym];
+    Price bid = b.ob->BestBid(), ask = b.ob->BestAsk();
+    if (bid == b.lastBid && ask == b.lastAsk) return;
+    b.lastBid = bid;
+    b.lastAsk = ask;
+    ++stats_.quoteUpdates;
+    b.quoteSig->notifyAll();
+}
+
+void SimVenue::trace(TraceOp op, uint32_t sym, Side side, OrderId id, Price px, Quantity qty) {
+    if (!rec_) return;
+    rec_->push_back(TraceRecord{(uint8_t)op, (uint8_t)(side == Side::Buy ? 0 : 1), 0, px, qty,
+                                sym + recBase_, id});
+}
+
+// -------------------- Helpers --------------------
+namespace {
+
+// Uniform in [ns/2, 3ns/2): keeps the mean, breaks lockstep between agents
+uint64_t jittered(AgentContext& a, uint64_t ns) {
+    return ns / 2 + a.rng.below(ns ? ns : 1);
+}
+
+void requote(SimVenue& v, AgentContext& a, uint32_t sym, Side side, OrderId& id, Price& cur,
+             Price target, bool allowed, const MarketMakerParams& p) {
+    bool live = id && v.isLive(id);
+    if (!allowed) {
+        if (live) v.cancel(a, sym, id);
+        id = 0;
+        return;
+    }
+    if (live && cur == target) return;
+    if (live && a.rng.uniform() < p.modifyShare) {
+        v.modify(a, sym, id, target, p.size);
+    } else {
+        if (live) v.cancel(a, sym, id);
+        id = v.limit(a, sym, side, target, p.size);
+    }
+    cur = target;
+    if (!v.isLive(id)) id = 0;   // crossed and filled on arrival
+}
+
+} // namespace
+
+// -------------------- Agent types --------------------
+AgentTask marketMaker(SimVenue& v, AgentContext& a, uint32_t sym, MarketMakerParams p) {
+    AgentScheduler& sched = v.scheduler();
+    OrderId bidId = 0, askId = 0;
+    Price bidPx = 0, askPx = 0;
+    co_await sched.sleep(a.rng.below(p.requoteNs + 1));
+    auto nextDrop = [&] {
+        return p.disconnectMeanNs ? sched.now() + (uint64_t)a.rng.exponential((double)p.disconnectMeanNs)
+                                  : UINT64_MAX;
+    };
+    uint64_t dropAt = nextDrop();
+    for (;;) {
+        if (sched.now() >= dropAt) {
+            v.disconnect(a);
+            bidId = askId = 0;
+            co_await sched.sleep(p.reconnectNs);
+            dropAt = nextDrop();
+        }
+        Price m = v.mid(sym);
+        Price skew = (Price)std::lround(a.position * p.skewPerUnit);
+        Price b = std::max<Price>(1, m - p.halfSpread - skew);
+        Price s = std::max<Price>(b + 1, m + p.halfSpread - skew);
+        requote(v, a, sym, Side::Buy, bidId, bidPx, b, a.position < p.maxPosition, p);
+        requote(v, a, sym, Side::Sell, askId, askPx, s, a.position > -p.maxPosition, p);
+        co_await sched.sleep(jittered(a, p.requoteNs));
+    }
+}
+
+AgentTask momentumTaker(SimVenue& v, AgentContext& a, uint32_t sym, MomentumParams p) {
+    std::vector<Price> hist(std::max<size_t>(p.lookback, 1));
+    size_t n = 0;
+    for (;;) {
+        co_await v.quotes(sym).wait();
+        Price m = v.mid(sym);
+        hist[n++ % hist.size()] = m;
+        if (n < hist.size()) continue;
+        Price move = m - hist[n % hist.size()];   // against the oldest sample
+        if (move >= p.threshold) {
+            if (Price ask = v.ask(sym)) v.ioc(a, sym, Side::Buy, ask + p.slippage, p.size);
+        } else if (move <= -p.threshold) {
+            if (Price bid = v.bid(sym)) v.ioc(a, sym, Side::Sell, std::max<Price>(1, bid - p.slippage), p.size);
+        } else {
+            continue;
+        }
+        n = 0;   // fresh window after acting
+        co_await v.scheduler().sleep(jittered(a, p.cooldownNs));
+    }
+}
+
+AgentTask noiseTrader(SimVenue& v, AgentContext& a, uint32_t sym, NoiseParams p) {
+    struct Resting { uint64_t expiry; OrderId id; };
+    std::vector<Resting> resting;
+    AgentScheduler& sched = v.scheduler();
+    for (;;) {
+        co_await sched.sleep((uint64_t)a.rng.exponential((double)p.meanGapNs) + 1);
+        uint64_t t = sched.now();
+        for (size_t i = 0; i < resting.size();) {
+            if (resting[i].expiry <= t) v.cancel(a, sym, resting[i].id);
+            else if (v.isLive(resting[i].id)) { ++i; continue; }
+            resting[i] = resting.back();
+            resting.pop_back();
+        }
+
+        Side side = a.rng.below(2) ? Side::Sell : Side::Buy;
+        Quantity q = 1 + (Quantity)a.rng.below(p.maxSize);
+        if (a.rng.uniform() < p.limitShare) {
+            Price ref = side == Side::Buy ? v.bid(sym) : v.ask(sym);
+            if (!ref) ref = v.mid(sym);
+            Price off = (Price)a.rng.below(p.maxOffset + 1);
+            Price px = std::max<Price>(1, side == Side::Buy ? ref - off : ref + off);
+            OrderId id = v.limit(a, sym, side, px, q);
+            if (v.isLive(id))
+                resting.push_back({t + (uint64_t)a.rng.exponential((double)p.meanLifetimeNs), id});
+        } else {
+            Price px = side == Side::Buy ? v.ask(sym) : v.bid(sym);
+            if (px) v.ioc(a, sym, side, px, q);
+        }
+    }
+}
+
+AgentTask slicer(SimVenue& v, AgentContext& a, uint32_t sym, SlicerParams p) {
+    // Progress is counted from the agent's own fill events (needs wantsFills)
+    Quantity done = 0;
+    auto drain = [&] { while (!a.fills.empty()) done += a.fills.take().qty; };
+    while (done < p.total) {
+        Quantity q = std::min(p.slice, p.total - done);
+        if (p.aggressive) {
+            Price touch = p.side == Side::Buy ? v.ask(sym) : v.bid(sym);
+            if (touch) {
+                Price px = p.side == Side::Buy ? touch + p.limitOffset
+                                               : std::max<Price>(1, touch - p.limitOffset);
+                v.ioc(a, sym, p.side, px, q);
+            }
+            drain();
+        } else {
+            // Rest at the touch and wait on fills; a slice nobody trades
+            // against within intervalNs is pulled and requoted at the touch
+            Price touch = p.side == Side::Buy ? v.bid(sym) : v.ask(sym);
+            OrderId id = v.limit(a, sym, p.side, touch ? touch : v.mid(sym), q);
+            uint64_t deadline = v.scheduler().now() + p.intervalNs;
+            bool stale = false;
+            while (v.isLive(id)) {
+                uint64_t t = v.scheduler().now();
+                if (t >= deadline) {
+                    v.cancel(a, sym, id);
+                    stale = true;
+                    break;
+                }
+                if (auto f = co_await a.fills.nextFor(deadline - t)) done += f->qty;
+            }
+            drain();
+            if (stale) continue;
+        }
+        if (done < p.total) co_await v.scheduler().sleep(jittered(a, p.intervalNs));
+    }
+}
@@ -0,0 +1,160 @@
+#pragma once
+// Requires C++20 (coroutines)
+#include "orderBook_core.hpp"
+#include "orderBook_risk.hpp"
+#include "orderBook_agents.hpp"
+#include "orderBook_rng.hpp"
+#include "orderBook_trace.hpp"
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// -------------------- Agent state --------------------
+struct AgentContext {
+    AgentContext(AgentScheduler& s, uint32_t agentId, uint64_t seed, bool fills = false)
+        : id(agentId), rng(seed ^ (0x9E3779B97F4A7C15ULL * (agentId + 1))), fills(s), wantsFills(fills) {}
+
+    uint32_t id;
+    Xoshiro256 rng;               // per-agent stream: results don't depend on interleaving
+    Mailbox<FillEvent> fills;     // only fed when wantsFills
+    bool wantsFills;
+    int64_t position = 0;         // filled buys - filled sells
+    uint64_t filledQty = 0;
+};
+
+struct VenueStats {
+    uint64_t adds = 0, iocs = 0, cancels = 0, modifies = 0;
+    uint64_t trades = 0, volume = 0, quoteUpdates = 0;
+    uint64_t riskRejects = 0, stpCancels = 0;
+    uint64_t disconnects = 0, disconnectCancels = 0;
+};
+
+// -------------------- Venue --------------------
+// Agent-facing wrapper over one core Orderbook per symbol: assigns order
+// ids, routes fills back to owning agents and publishes BBO changes.
+class SimVenue {
+public:
+    SimVenue(AgentScheduler& sched, size_t nSymbols, Price refPx = 100);
+
+    // Order entry through the core engine's public API
+    OrderId  limit(AgentContext& a, uint32_t sym, Side side, Price px, Quantity qty);
+    Quantity ioc(AgentContext& a, uint32_t sym, Side side, Price px, Quantity qty);   // filled qty
+    void     cancel(AgentContext& a, uint32_t sym, OrderId id);
+    void     modify(AgentContext& a, uint32_t sym, OrderId id, Price px, Quantity qty);
+    bool     isLive(OrderId id) const { return owners_.count(id) != 0; }
+
+    // Pull all of an agent's orders on a symbol (both sides or one) in one
+    // engine call; returns how many were cancelled. Needs accounts (enableRisk).
+    size_t   cancelAll(AgentContext& a, uint32_t sym);
+    size_t   cancelAll(AgentContext& a, uint32_t sym, Side side);
+
+    // Cancel-on-disconnect: the agent's session dropped, so every order it
+    // still has resting goes, one engine call per book it rests in rather
+    // than a cancel per order. Returns how many were pulled. Needs accounts.
+    size_t   disconnect(AgentContext& a);
+
+    // Market data
+    Price bid(uint32_t sym) const { return books_[sym].ob->BestBid(); }
+    Price ask(uint32_t sym) const { return books_[sym].ob->BestAsk(); }
+    Price mid(uint32_t sym) const;          // falls back to last trade, then the reference price
+    Signal& quotes(uint32_t sym) { return *books_[sym].quoteSig; }
+
+    AgentScheduler& scheduler() { return sched_; }
+    size_t symbols() const { return books_.size(); }
+    size_t resting(uint32_t sym) const { return books_[sym].ob->size(); }
+    const VenueStats& stats() const { return stats_; }
+
+    // Pre-trade risk for agents firstAgent..firstAgent+nAgents-1, one account
+    // each. Each agent trades a single symbol, so one RiskBook serves all books.
+    void enableRisk(uint32_t firstAgent, size_t nAgents, const RiskLimits& limits);
+    void setSelfTradePrevention(StpMode mode);   // needs accounts (enableRisk)
+
+    // Optional capture of every op (symbol = sym + symbolBase) for bench replay
+    void record(std::vector<TraceRecord>* out, uint32_t symbolBase = 0) { rec_ = out; recBase_ = symbolBase; }
+
+private:
+    struct Book {
+        std::unique_ptr<Orderbook> ob;
+        std::unique_ptr<Signal> quoteSig;
+        Price lastBid = 0, lastAsk = 0, lastTrade = 0;
+    };
+    struct Owner {
+        AgentContext* agent;
+        Quantity remaining;
+    };
+
+    void route(uint32_t sym, OrderId aggressor, const Trades& trades);
+    void fill(OrderId id, Price px, Quantity q, int sign);
+    void publish(uint32_t sym);
+    void trace(TraceOp op, uint32_t sym, Side side, OrderId id, Price px, Quantity qty);
+    AccountId account(const AgentContext& a) const { return risk_ ? a.id - accountBase_ + 1 : 0; }
+    bool refused(const Orderbook& ob);
+    void forget(const Orderbook& ob);
+    size_t pulled(uint32_t sym, const std::vector<OrderId>& ids);
+
+    AgentScheduler& sched_;
+    std::vector<Book> books_;
+    std::unordered_map<OrderId, Owner> owners_;
+    Price refPx_;
+    OrderId nextId_ = 1;
+    VenueStats stats_;
+    std::unique_ptr<RiskBook> risk_;
+    std::vector<std::vector<uint32_t>> sessionBooks_;   // by account: symbols it has rested in
+    uint32_t accountBase_ = 0;
+    std::vector<TraceRecord>* rec_ = nullptr;
+    uint32_t recBase_ = 0;
+};
+
+// -------------------- Agent types --------------------
+// Quotes both sides around the mid, skewed against inventory; requotes by
+// modify (share modifyShare) or cancel/replace. Stops adding to a side once
+// |position| reaches maxPosition. With disconnectMeanNs set, its session
+// drops at exponential intervals and it requotes after reconnectNs.
+struct MarketMakerParams {
+    Price    halfSpread  = 1;
+    Quantity size        = 10;
+    uint64_t requoteNs   = 5'000'000;
+    int64_t  maxPosition = 500;
+    double   skewPerUnit = 0.02;     // ticks of skew per unit of position
+    double   modifyShare = 0.7;
+    uint64_t disconnectMeanNs = 0;   // 0 = never disconnects
+    uint64_t reconnectNs = 1'000'000'000;
+};
+AgentTask marketMaker(SimVenue& v, AgentContext& a, uint32_t sym, MarketMakerParams p);
+
+// Wakes on every BBO change; buys (sells) with an IOC through the touch when
+// the mid has risen (fallen) by threshold ticks over the last lookback updates.
+struct MomentumParams {
+    size_t   lookback   = 20;
+    Price    threshold  = 2;
+    Quantity size       = 5;
+    Price    slippage   = 1;
+    uint64_t cooldownNs = 50'000'000;
+};
+AgentTask momentumTaker(SimVenue& v, AgentContext& a, uint32_t sym, MomentumParams p);
+
+// Random arrivals: passive limits near the touch that are cancelled after an
+// exponential lifetime, or IOCs at the touch.
+struct NoiseParams {
+    uint64_t meanGapNs      = 100'000'000;
+    double   limitShare     = 0.7;
+    Price    maxOffset      = 5;
+    Quantity maxSize        = 20;
+    uint64_t meanLifetimeNs = 2'000'000'000;
+};
+AgentTask noiseTrader(SimVenue& v, AgentContext& a, uint32_t sym, NoiseParams p);
+
+// Works a parent order in child slices every intervalNs: aggressive slices
+// are IOCs limitOffset through the touch; passive slices rest at the touch
+// and the agent waits on its fills before sending the next one, cancelling
+// and requoting at the new touch if the slice sits unfilled for intervalNs.
+struct SlicerParams {
+    Side     side       = Side::Buy;
+    Quantity total      = 10'000;
+    Quantity slice      = 100;
+    uint64_t intervalNs = 1'000'000'000;
+    bool     aggressive = true;
+    Price    limitOffset = 1;
+};
+AgentTask slicer(SimVenue& v, AgentContext& a, uint32_t sym, SlicerParams p);
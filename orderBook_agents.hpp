@@ -0,0 +1,281 @@
+#pragma once
+// Requires C++20 (coroutines)
+#include "orderBook_des.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// -------------------- Coroutine agents --------------------
+// An agent is a coroutine returning AgentTask. It suspends on a delay, a
+// fill or a market-data update, and an AgentScheduler resumes it; one
+// scheduler thread multiplexes any number of agents. The framework knows
+// nothing about the engine: hosts post FillEvent / QuoteEvent into the
+// agents' mailboxes. An exception escaping an agent is rethrown from the
+// scheduler's run call.
+
+class AgentScheduler;
+
+struct AgentTask {
+    struct promise_type {
+        AgentTask get_return_object() {
+            return AgentTask{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }   // started by spawn()
+        std::suspend_always final_suspend() noexcept { return {}; }     // destroyed by the scheduler
+        void return_void() {}
+        void unhandled_exception() { error = std::current_exception(); }
+        std::exception_ptr error;
+    };
+
+    explicit AgentTask(std::coroutine_handle<promise_type> h) : handle(h) {}
+    AgentTask(AgentTask&& o) noexcept : handle(std::exchange(o.handle, nullptr)) {}
+    AgentTask(const AgentTask&) = delete;
+    ~AgentTask() { if (handle) handle.destroy(); }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+// -------------------- Scheduler --------------------
+class AgentScheduler {
+public:
+    // Wall-clock scheduler: timers fire against steady_clock
+    AgentScheduler() = default;
+    // Virtual-time scheduler: timers and wake-ups become events on des
+    explicit AgentScheduler(DiscreteEventSim& des) : des_(&des) {}
+
+    ~AgentScheduler() {
+        for (auto h : owned_) h.destroy();
+    }
+    AgentScheduler(const AgentScheduler&) = delete;
+    AgentScheduler& operator=(const AgentScheduler&) = delete;
+
+    bool isVirtual() const { return des_ != nullptr; }
+
+    // ns; steady_clock in wall mode, simulated time in virtual mode
+    uint64_t now() const {
+        if (des_) return des_->now();
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void spawn(AgentTask task) {
+        auto h = std::exchange(task.handle, nullptr);
+        owned_.push_back(h);
+        ++live_;
+        makeReady(h);
+    }
+
+    size_t liveAgents() const { return live_; }
+    uint64_t resumes() const { return resumes_; }
+
+    void makeReady(std::coroutine_handle<> h) {
+        if (des_) des_->after(0, [this, h] { resume(h); });
+        else ready_.push_back(h);
+    }
+
+    void wakeAt(uint64_t t, std::coroutine_handle<> h) {
+        if (des_) { des_->at(t, [this, h] { resume(h); }); return; }
+        timers_.push_back({t, seq_++, h, nullptr});
+        std::push_heap(timers_.begin(), timers_.end(), Later());
+    }
+
+    // Run fn on the scheduler at t; the building block for waits that may
+    // end early (fn checks whether the waiter is still waiting)
+    void callAt(uint64_t t, std::function<void()> fn) {
+        if (des_) { des_->at(t, std::move(fn)); return; }
+        timers_.push_back({t, seq_++, nullptr, std::move(fn)});
+        std::push_heap(timers_.begin(), timers_.end(), Later());
+    }
+
+    // Awaitable: co_await sched.sleep(ns)
+    struct Sleep {
+        AgentScheduler& s;
+        uint64_t dt;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) { s.wakeAt(s.now() + dt, h); }
+        void await_resume() const noexcept {}
+    };
+    Sleep sleep(uint64_t ns) { return Sleep{*this, ns}; }
+
+    // Virtual mode: advance the shared clock by ns, running everything due.
+    // Wall mode: run agents for ns of real time.
+    void runFor(uint64_t ns) {
+        if (des_) { des_->runUntil(des_->now() + ns); return; }
+        std::atomic<bool> keep{true};
+        runWall(keep, now() + ns);
+    }
+
+    // Wall mode: run until keepRunning turns false (or the deadline passes)
+    void runWall(const std::atomic<bool>& keepRunning, uint64_t deadline = UINT64_MAX) {
+        while (keepRunning.load(std::memory_order_relaxed) && live_ > 0) {
+            uint64_t t = now();
+            if (t >= deadline) break;
+            while (!timers_.empty() && timers_.front().t <= t) {
+                std::pop_heap(timers_.begin(), timers_.end(), Later());
+                Timer tm = std::move(timers_.back());
+                timers_.pop_back();
+                if (tm.fn) tm.fn();
+                else ready_.push_back(tm.h);
+            }
+            if (!ready_.empty()) {
+                // only what is ready now; agents made ready meanwhile wait one round
+                size_t n = ready_.size();
+                for (size_t i = 0; i < n; ++i) {
+                    auto h = ready_.front();
+                    ready_.pop_front();
+                    resume(h);
+                }
+                continue;
+            }
+            uint64_t next = timers_.empty() ? t + 1'000'000 : timers_.front().t;
+            next = std::min(next, deadline);
+            if (next - t > 50'000)   // sleep if the next timer is > 50us away
+                std::this_thread::sleep_for(std::chrono::nanoseconds(next - t - 20'000));
+            else
+                std::this_thread::yield();
+        }
+    }
+
+private:
+    void resume(std::coroutine_handle<> h) {
+        ++resumes_;
+        h.resume();
+        if (!h.done()) return;
+        --live_;                    // frame stays owned until the scheduler goes away
+        auto& p = std::coroutine_handle<AgentTask::promise_type>::from_address(h.address()).promise();
+        if (p.error) std::rethrow_exception(std::exchange(p.error, nullptr));
+    }
+
+    struct Timer {
+        uint64_t t;
+        uint64_t seq;
+        std::coroutine_handle<> h;
+        std::function<void()> fn;   // callAt timers instead of a plain wake-up
+    };
+    struct Later {
+        bool operator()(const Timer& a, const Timer& b) const {
+            return a.t != b.t ? a.t > b.t : a.seq > b.seq;
+        }
+    };
+
+    DiscreteEventSim* des_ = nullptr;
+    std::deque<std::coroutine_handle<>> ready_;
+    std::vector<Timer> timers_;
+    std::vector<std::coroutine_handle<AgentTask::promise_type>> owned_;
+    uint64_t seq_ = 0;
+    size_t live_ = 0;
+    uint64_t resumes_ = 0;
+};
+
+// -------------------- Mailbox --------------------
+// Host-to-agent event queue (fills, market data). co_await next() returns
+// the oldest item, suspending until one is posted; nextFor(ns) gives up
+// after ns and returns nullopt. One waiter at a time.
+template <class T>
+class Mailbox {
+public:
+    explicit Mailbox(AgentScheduler& s) : sched_(s) {}
+
+    void post(const T& item) {
+        items_.push_back(item);
+        if (waiter_) sched_.makeReady(std::exchange(waiter_, nullptr));
+    }
+
+    bool empty() const { return items_.empty(); }
+    size_t size() const { return items_.size(); }
+
+    // Take without waiting (caller checked !empty())
+    T take() {
+        T v = std::move(items_.front());
+        items_.pop_front();
+        return v;
+    }
+
+    struct Next {
+        Mailbox& m;
+        bool await_ready() const noexcept { return !m.items_.empty(); }
+        void await_suspend(std::coroutine_handle<> h) { m.waiter_ = h; }
+        T await_resume() { return m.take(); }
+    };
+    Next next() { return Next{*this}; }
+
+    // Whichever comes first wakes the waiter: a post clears waiter_ so the
+    // timer finds nothing to do, and a resumed wait bumps waitSeq_ so an
+    // older timer can never wake a later wait
+    struct NextFor {
+        Mailbox& m;
+        uint64_t dt;
+        bool await_ready() const noexcept { return !m.items_.empty(); }
+        void await_suspend(std::coroutine_handle<> h) {
+            m.waiter_ = h;
+            Mailbox* mb = &m;
+            uint64_t seq = m.waitSeq_;
+            m.sched_.callAt(m.sched_.now() + dt, [mb, seq] {
+                if (mb->waitSeq_ == seq && mb->waiter_)
+                    mb->sched_.makeReady(std::exchange(mb->waiter_, nullptr));
+            });
+        }
+        std::optional<T> await_resume() {
+            ++m.waitSeq_;
+            if (m.items_.empty()) return std::nullopt;
+            return m.take();
+        }
+    };
+    NextFor nextFor(uint64_t ns) { return NextFor{*this, ns}; }
+
+private:
+    AgentScheduler& sched_;
+    std::deque<T> items_;
+    std::coroutine_handle<> waiter_ = nullptr;
+    uint64_t waitSeq_ = 0;
+};
+
+// -------------------- Signal --------------------
+// Broadcast wake-up (e.g. "BBO changed"): co_await wait() suspends until
+// the next notifyAll(); every agent waiting at that moment is resumed.
+class Signal {
+public:
+    explicit Signal(AgentScheduler& s) : sched_(s) {}
+
+    void notifyAll() {
+        for (auto h : waiters_) sched_.makeReady(h);
+        waiters_.clear();
+    }
+    size_t waiting() const { return waiters_.size(); }
+
+    struct Wait {
+        Signal& s;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) { s.waiters_.push_back(h); }
+        void await_resume() const noexcept {}
+    };
+    Wait wait() { return Wait{*this}; }
+
+private:
+    AgentScheduler& sched_;
+    std::vector<std::coroutine_handle<>> waiters_;
+};
+
+// Events hosts deliver to agents
+struct FillEvent {
+    uint64_t orderId;
+    int32_t  px;
+    uint32_t qty;
+    uint64_t ts;
+};
+
+struct QuoteEvent {
+    uint32_t symbol;
+    int32_t  bid;     // 0 if empty
+    int32_t  ask;     // 0 if empty
+    uint64_t ts;
+};
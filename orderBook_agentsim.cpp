@@ -0,0 +1,195 @@
+#include "orderBook_agentlib.hpp"
+#include "orderBook_des.hpp"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// ---------- Population ----------
+// Agent counts are per symbol
+struct Population {
+    size_t makers = 4;
+    size_t momentum = 20;
+    size_t noise = 200;
+    size_t slicers = 1;
+};
+
+struct ShardResult {
+    VenueStats stats;
+    uint64_t events = 0;
+    uint64_t resumes = 0;
+    size_t agents = 0;
+    size_t liveAgents = 0;
+    size_t resting = 0;
+    vector<TraceRecord> trace;
+};
+
+// One scheduler + venue per thread over its own symbols; symbols never
+// cross shards, so shards share nothing and runs are deterministic per seed.
+static void runShard(size_t firstSym, size_t nSyms, const Population& pop, const RiskLimits* risk,
+                     StpMode stp, uint64_t disconnectNs, bool virtualTime, uint64_t horizonNs, uint64_t seed, bool record, ShardResult& out) {
+    DiscreteEventSim des;
+    unique_ptr<AgentScheduler> sched = virtualTime ? make_unique<AgentScheduler>(des)
+                                                   : make_unique<AgentScheduler>();
+    SimVenue venue(*sched, nSyms);
+    if (record) venue.record(&out.trace, (uint32_t)firstSym);
+
+    deque<AgentContext> agents;   // stable addresses for the coroutines
+    // Agent ids (and so their RNG streams) don't depend on the thread split
+    size_t perSymbol = pop.makers + pop.momentum + pop.noise + pop.slicers;
+    uint32_t nextAgent = (uint32_t)(firstSym * perSymbol);
+    if (risk) venue.enableRisk(nextAgent, nSyms * perSymbol, *risk);
+    venue.setSelfTradePrevention(stp);
+    auto ctx = [&](bool fills = false) -> AgentContext& {
+        return agents.emplace_back(*sched, nextAgent++, seed, fills);
+    };
+    for (uint32_t s = 0; s < nSyms; ++s) {
+        for (size_t i = 0; i < pop.makers; ++i) {
+            MarketMakerParams p;
+            p.halfSpread = 1 + (Price)(i % 3);
+            p.disconnectMeanNs = disconnectNs;
+            sched->spawn(marketMaker(venue, ctx(), s, p));
+        }
+        for (size_t i = 0; i < pop.momentum; ++i)
+            sched->spawn(momentumTaker(venue, ctx(), s, MomentumParams{}));
+        for (size_t i = 0; i < pop.noise; ++i)
+            sched->spawn(noiseTrader(venue, ctx(), s, NoiseParams{}));
+        for (size_t i = 0; i < pop.slicers; ++i) {
+            SlicerParams p;
+            p.side = i % 2 ? Side::Sell : Side::Buy;
+            p.aggressive = i % 4 < 2;
+            sched->spawn(slicer(venue, ctx(true), s, p));
+        }
+    }
+
+    out.agents = agents.size();
+    sched->runFor(horizonNs);
+
+    out.stats = venue.stats();
+    out.events = des.processed();
+    out.resumes = sched->resumes();
+    out.liveAgents = sched->liveAgents();
+    for (uint32_t s = 0; s < nSyms; ++s) out.resting += venue.resting(s);
+}
+
+// ---------- Main ----------
+// Usage: orderBook_agentsim [--symbols n] [--makers n] [--momentum n] [--noise n] [--slicers n]
+//                           [--hours h | --wall <sec>] [--threads n] [--seed n] [--record <trace>]
+//                           [--max-order n] [--max-open n] [--max-position n]
+//                           [--stp newest|oldest|both|decrement] [--disconnect <mean-sec>]
+int main(int argc, char** argv) {
+    Population pop;
+    size_t nSymbols = 4;
+    double hours = 0.1, wallSec = 0;
+    unsigned nThreads = 1;
+    uint64_t seed = 1;
+    string recordPath;
+    RiskLimits limits;
+    StpMode stp = StpMode::Off;
+    double disconnectSec = 0;
+    for (int i = 1; i + 1 < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--symbols") nSymbols = stoull(argv[++i]);
+        else if (arg == "--makers") pop.makers = stoull(argv[++i]);
+        else if (arg == "--momentum") pop.momentum = stoull(argv[++i]);
+        else if (arg == "--noise") pop.noise = stoull(argv[++i]);
+        else if (arg == "--slicers") pop.slicers = stoull(argv[++i]);
+        else if (arg == "--hours") hours = stod(argv[++i]);
+        else if (arg == "--wall") wallSec = stod(argv[++i]);
+        else if (arg == "--threads") nThreads = (unsigned)stoul(argv[++i]);
+        else if (arg == "--seed") seed = stoull(argv[++i]);
+        else if (arg == "--record") recordPath = argv[++i];
+        else if (arg == "--max-order") limits.maxOrderQty = (Quantity)stoul(argv[++i]);
+        else if (arg == "--max-open") limits.maxOpenOrders = (uint32_t)stoul(argv[++i]);
+        else if (arg == "--max-position") limits.maxPosition = stoll(argv[++i]);
+        else if (arg == "--disconnect") disconnectSec = stod(argv[++i]);
+        else if (arg == "--stp") {
+            string m = argv[++i];
+            stp = m == "newest" ? StpMode::CancelNewest : m == "oldest" ? StpMode::CancelOldest
+                : m == "both" ? StpMode::CancelBoth : m == "decrement" ? StpMode::Decrement : StpMode::Off;
+        }
+    }
+    // Accounts (and so self-trade prevention and cancel-on-disconnect) come
+    // with the risk book
+    uint64_t disconnectNs = (uint64_t)(disconnectSec * 1e9);
+    bool withRisk = limits.maxOrderQty || limits.maxOpenOrders || limits.maxPosition ||
+                    stp != StpMode::Off || disconnectNs;
+    nSymbols = max<size_t>(nSymbols, 1);
+    nThreads = (unsigned)min<size_t>(max(1u, nThreads), nSymbols);
+    bool virtualTime = wallSec <= 0;
+    uint64_t horizon = (uint64_t)((virtualTime ? hours * 3600.0 : wallSec) * 1e9);
+
+    // Contiguous symbol ranges per thread
+    vector<ShardResult> shards(nThreads);
+    vector<thread> workers;
+    auto t0 = chrono::steady_clock::now();
+    for (unsigned t = 0; t < nThreads; ++t) {
+        size_t first = nSymbols * t / nThreads, last = nSymbols * (t + 1) / nThreads;
+        workers.emplace_back(runShard, first, last - first, cref(pop), withRisk ? &limits : nullptr,
+                             stp, disconnectNs, virtualTime, horizon, seed, !recordPath.empty(), ref(shards[t]));
+    }
+    for (auto& w : workers) w.join();
+    double wall = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    VenueStats total;
+    uint64_t events = 0, resumes = 0;
+    size_t agents = 0, live = 0, resting = 0;
+    for (auto& r : shards) {
+        total.adds += r.stats.adds;
+        total.iocs += r.stats.iocs;
+        total.cancels += r.stats.cancels;
+        total.modifies += r.stats.modifies;
+        total.trades += r.stats.trades;
+        total.volume += r.stats.volume;
+        total.quoteUpdates += r.stats.quoteUpdates;
+        total.riskRejects += r.stats.riskRejects;
+        total.stpCancels += r.stats.stpCancels;
+        total.disconnects += r.stats.disconnects;
+        total.disconnectCancels += r.stats.disconnectCancels;
+        events += r.events;
+        resumes += r.resumes;
+        agents += r.agents;
+        live += r.liveAgents;
+        resting += r.resting;
+    }
+    uint64_t ops = total.adds + total.iocs + total.cancels + total.modifies;
+
+    cout << fixed << setprecision(2);
+    cout << "=== AGENT SIMULATION ===\n";
+    if (virtualTime)
+        cout << "Simulated      : " << hours << " h virtual (seed " << seed << ")\n";
+    else
+        cout << "Simulated      : " << wallSec << " s wall clock (seed " << seed << ")\n";
+    cout << "Symbols        : " << nSymbols << " on " << nThreads << " thread(s)\n";
+    cout << "Agents         : " << agents << " (" << live << " still running)\n";
+    cout << "Ops            : " << ops << "  add=" << total.adds << " ioc=" << total.iocs
+         << " cancel=" << total.cancels << " modify=" << total.modifies << "\n";
+    cout << "Trades         : " << total.trades << " (volume " << total.volume << ")\n";
+    cout << "Quote updates  : " << total.quoteUpdates << "\n";
+    if (withRisk) cout << "Risk rejects   : " << total.riskRejects << "\n";
+    if (stp != StpMode::Off) cout << "STP cancels    : " << total.stpCancels << "\n";
+    if (disconnectNs)
+        cout << "Disconnects    : " << total.disconnects << " (" << total.disconnectCancels
+             << " orders pulled)\n";
+    cout << "Resting orders : " << resting << "\n";
+    cout << "Agent resumes  : " << resumes;
+    if (virtualTime) cout << " (" << events << " events)";
+    cout << "\n";
+    cout << "Wall time      : " << wall << " s (" << (ops / max(wall, 1e-9) / 1e6) << " M ops/s)\n";
+
+    if (!recordPath.empty()) {
+        TraceWriter w(recordPath);
+        if (!w.isOpen()) {
+            cerr << "cannot open trace file " << recordPath << "\n";
+            return 1;
+        }
+        for (auto& r : shards) w.write(r.trace);
+        cout << "Recorded " << w.count() << " ops to " << recordPath << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,329 @@
+#include "orderBook_core.hpp"
+#include "orderBook_workload.hpp"
+#include "orderBook_loader.hpp"
+#include "orderBook_ring.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// ---------- Sample data ----------
+// Interleaved per-symbol synthetic flows in the CSV event format
+void makeSample(const string& path, size_t nEvents, size_t nSymbols, uint64_t seed) {
+    vector<WorkloadGenerator> gens;
+    gens.reserve(nSymbols);
+    for (size_t s = 0; s < nSymbols; ++s) {
+        WorkloadConfig cfg;
+        cfg.seed = seed + s;
+        cfg.firstId = 1 + s * 100'000'000ULL;
+        cfg.startMid = (Price)(100 + 10 * (s % 50));
+        gens.emplace_back(cfg);
+    }
+
+    static const char opCode[4] = {'A', 'C', 'M', 'I'};
+    Xoshiro256 pick(seed);
+    ofstream out(path);
+    out << "ts,symbol,op,side,id,px,qty\n";
+    uint64_t ts = 34'200'000'000'000ULL;   // 09:30 in ns since midnight
+    for (size_t i = 0; i < nEvents; ++i) {
+        size_t s = pick.below(nSymbols);
+        ts += 1 + pick.below(2000);
+        WorkloadOp op = gens[s].next();
+        out << ts << ",SYM" << setw(5) << setfill('0') << s << setfill(' ') << ","
+            << opCode[(int)op.type] << "," << (op.side == Side::Buy ? 'B' : 'S') << ","
+            << op.id << "," << op.px << "," << op.qty << "\n";
+    }
+    cout << "Wrote " << nEvents << " events for " << nSymbols << " symbols to " << path << "\n";
+}
+
+// ---------- Convert CSV -> binary ----------
+void convert(const string& in, const string& out) {
+    EventFileParser parser(in);
+    vector<HistEvent> events;
+    parser.parse([&](const HistEvent* ev, size_t n) { events.insert(events.end(), ev, ev + n); });
+    writeEventFile(out, parser.symbols(), events);
+    cout << "Converted " << events.size() << " events (" << parser.symbols().size()
+         << " symbols, " << parser.badRows() << " bad rows) to " << out << "\n";
+}
+
+// ---------- Parse-only throughput ----------
+void parseOnly(const string& path) {
+    auto t0 = chrono::steady_clock::now();
+    EventFileParser parser(path);
+    uint64_t sum = 0;
+    size_t n = parser.parse([&](const HistEvent* ev, size_t k) { sum += ev[k - 1].ts; });
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    cout << fixed << setprecision(2);
+    cout << "Parsed " << n << " events in " << secs << " s ("
+         << (n / secs / 1e6) << " M events/sec, checksum " << (sum & 0xFFFF) << ")\n";
+}
+
+// ---------- Backtest ----------
+void runBacktest(const string& path) {
+    cout << "\n=== BACKTEST: " << path << " ===\n";
+    auto t0 = chrono::steady_clock::now();
+
+    BacktestFeed feed(path);
+    vector<unique_ptr<Orderbook>> books;
+    vector<HistEvent> buf(1024);
+    uint64_t events = 0, trades = 0;
+
+    while (size_t n = feed.next(buf.data(), buf.size())) {
+        for (size_t i = 0; i < n; ++i) {
+            const TraceRecord& r = buf[i].rec;
+            if (r.symbol >= books.size()) books.resize(r.symbol + 1);
+            auto& book = books[r.symbol];
+            if (!book) book.reset(new Orderbook);
+            trades += applyOp(*book, fromTrace(r)).size();
+        }
+        events += n;
+    }
+
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    size_t resting = 0;
+    for (auto& b : books) if (b) resting += b->size();
+
+    cout << fixed << setprecision(2);
+    cout << "Symbols        : " << feed.symbols().size() << "\n";
+    cout << "Events         : " << events << " (" << feed.badRows() << " bad rows skipped)\n";
+    cout << "Trades         : " << trades << "\n";
+    cout << "Resting orders : " << resting << "\n";
+    cout << "Elapsed time   : " << secs << " s\n";
+    cout << "Throughput     : " << (events / secs) << " events/sec\n";
+    cout << "Matcher waits  : " << feed.consumerWaits() << " empty-ring polls\n";
+    cout << "==========================\n";
+}
+
+// ---------- Parallel multi-symbol backtest ----------
+// Books are independent per symbol: the feed's parser thread streams the
+// file, this thread routes each event by symbol to a worker's SPSC ring,
+// and every worker replays its symbols with its own books as events arrive.
+// Memory stays at the rings plus the books, whatever the file size. Trades
+// are merged by (ts, file order) at the end, which reproduces the serial
+// run exactly.
+struct BacktestTrade {
+    uint64_t ts;
+    uint64_t seq;      // index of the triggering event in the file
+    uint32_t symbol;
+    Trade    trade;
+};
+
+struct SymbolStats {
+    uint64_t events = 0;
+    uint64_t trades = 0;
+    uint64_t volume = 0;
+    size_t   resting = 0;
+};
+
+struct RoutedEvent {
+    HistEvent ev;
+    uint64_t  seq;
+};
+
+struct Worker {
+    explicit Worker(size_t ringCapacity) : ring(ringCapacity) {}
+    SpscRing<RoutedEvent> ring;
+    atomic<bool> done{false};              // router has pushed its last event
+    vector<unique_ptr<Orderbook>> books;   // by symbol; only this worker's symbols
+    vector<SymbolStats> stats;             // likewise
+    vector<BacktestTrade> trades;
+    uint64_t waits = 0;                    // polls that found the ring empty
+};
+
+static void replayWorker(Worker& w) {
+    vector<RoutedEvent> buf(1024);
+    for (;;) {
+        size_t n = w.ring.tryPop(buf.data(), buf.size());
+        if (!n) {
+            if (w.done.load(memory_order_acquire) && !(n = w.ring.tryPop(buf.data(), buf.size()))) break;
+            if (!n) {
+                ++w.waits;
+                this_thread::yield();
+                continue;
+            }
+        }
+        for (size_t i = 0; i < n; ++i) {
+            const HistEvent& ev = buf[i].ev;
+            uint32_t sym = ev.rec.symbol;
+            if (sym >= w.books.size()) {
+                w.books.resize(sym + 1);
+                w.stats.resize(sym + 1);
+            }
+            auto& book = w.books[sym];
+            if (!book) book.reset(new Orderbook);
+            Trades ts = applyOp(*book, fromTrace(ev.rec));
+            SymbolStats& st = w.stats[sym];
+            ++st.events;
+            st.trades += ts.size();
+            for (auto& t : ts) {
+                st.volume += t.bid.qty;
+                w.trades.push_back({ev.ts, buf[i].seq, sym, t});
+            }
+        }
+    }
+    for (size_t s = 0; s < w.books.size(); ++s)
+        if (w.books[s]) w.stats[s].resting = w.books[s]->size();
+}
+
+void runParallelBacktest(const string& path, unsigned nThreads, const string& tradesPath) {
+    cout << "\n=== PARALLEL BACKTEST: " << path << " (" << nThreads << " threads) ===\n";
+    auto t0 = chrono::steady_clock::now();
+
+    BacktestFeed feed(path);
+    vector<unique_ptr<Worker>> workers;
+    vector<thread> threads;
+    for (unsigned w = 0; w < nThreads; ++w) {
+        workers.emplace_back(new Worker(1 << 14));
+        threads.emplace_back(replayWorker, ref(*workers.back()));
+    }
+
+    // A symbol goes to the worker that has been routed the fewest events
+    // when it first appears; it stays there, so its events keep file order.
+    // Events are staged per worker and pushed in batches.
+    const uint32_t kUnowned = UINT32_MAX;
+    vector<uint32_t> owner;
+    vector<uint64_t> load(nThreads, 0);
+    vector<vector<RoutedEvent>> staged(nThreads);
+    const size_t kBatch = 256;
+    uint64_t routerWaits = 0;
+    auto flush = [&](unsigned w) {
+        const RoutedEvent* p = staged[w].data();
+        size_t n = staged[w].size();
+        while (n) {
+            size_t k = workers[w]->ring.tryPush(p, n);
+            p += k;
+            n -= k;
+            if (!k) { ++routerWaits; this_thread::yield(); }   // worker is behind
+        }
+        staged[w].clear();
+    };
+
+    vector<HistEvent> buf(1024);
+    uint64_t nEvents = 0;
+    while (size_t n = feed.next(buf.data(), buf.size())) {
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t sym = buf[i].rec.symbol;
+            if (sym >= owner.size()) owner.resize(sym + 1, kUnowned);
+            if (owner[sym] == kUnowned)
+                owner[sym] = (uint32_t)(min_element(load.begin(), load.end()) - load.begin());
+            unsigned w = owner[sym];
+            ++load[w];
+            staged[w].push_back({buf[i], nEvents++});
+            if (staged[w].size() == kBatch) flush(w);
+        }
+    }
+    for (unsigned w = 0; w < nThreads; ++w) {
+        flush(w);
+        workers[w]->done.store(true, memory_order_release);
+    }
+    for (auto& th : threads) th.join();
+    const auto& symbols = feed.symbols();   // complete once the feed is drained
+    auto tReplayed = chrono::steady_clock::now();
+
+    // k-way merge on (ts, seq); each worker's trades are already in file order
+    auto key = [](const BacktestTrade& t) { return make_pair(t.ts, t.seq); };
+    for (auto& w : workers)
+        if (!is_sorted(w->trades.begin(), w->trades.end(),
+                       [&](const BacktestTrade& a, const BacktestTrade& b) { return key(a) < key(b); }))
+            stable_sort(w->trades.begin(), w->trades.end(),
+                        [&](const BacktestTrade& a, const BacktestTrade& b) { return key(a) < key(b); });
+
+    using Head = pair<pair<uint64_t, uint64_t>, unsigned>;
+    priority_queue<Head, vector<Head>, greater<Head>> heads;
+    vector<size_t> pos(nThreads, 0);
+    for (unsigned w = 0; w < nThreads; ++w)
+        if (!workers[w]->trades.empty()) heads.push({key(workers[w]->trades[0]), w});
+
+    ofstream out;
+    if (!tradesPath.empty()) {
+        out.open(tradesPath);
+        out << "ts,symbol,qty,bid_id,bid_px,ask_id,ask_px\n";
+    }
+    uint64_t merged = 0, checksum = 0;
+    while (!heads.empty()) {
+        unsigned w = heads.top().second;
+        heads.pop();
+        const vector<BacktestTrade>& trades = workers[w]->trades;
+        const BacktestTrade& t = trades[pos[w]++];
+        checksum = checksum * 1099511628211ULL ^ (t.trade.bid.orderId * 31 + t.trade.ask.orderId + t.trade.bid.qty);
+        if (out.is_open())
+            out << t.ts << "," << symbols[t.symbol] << "," << t.trade.bid.qty << ","
+                << t.trade.bid.orderId << "," << t.trade.bid.price << ","
+                << t.trade.ask.orderId << "," << t.trade.ask.price << "\n";
+        ++merged;
+        if (pos[w] < trades.size()) heads.push({key(trades[pos[w]]), w});
+    }
+    auto tMerged = chrono::steady_clock::now();
+
+    uint64_t volume = 0, workerWaits = 0;
+    size_t resting = 0, active = 0;
+    for (auto& w : workers) {
+        workerWaits += w->waits;
+        for (auto& st : w->stats) {
+            volume += st.volume;
+            resting += st.resting;
+            active += st.events ? 1 : 0;
+        }
+    }
+    auto secs = [](chrono::steady_clock::time_point a, chrono::steady_clock::time_point b) {
+        return chrono::duration<double>(b - a).count();
+    };
+
+    cout << fixed << setprecision(2);
+    cout << "Symbols        : " << active << " active / " << symbols.size() << "\n";
+    cout << "Events         : " << nEvents << " (" << feed.badRows() << " bad rows skipped)\n";
+    cout << "Trades         : " << merged << " (volume " << volume << ", checksum " << hex << checksum << dec << ")\n";
+    cout << "Resting orders : " << resting << "\n";
+    cout << "Parse + replay : " << secs(t0, tReplayed) << " s (" << (nEvents / secs(t0, tReplayed))
+         << " events/sec, streamed)\n";
+    cout << "Merge          : " << secs(tReplayed, tMerged) << " s\n";
+    cout << "Total          : " << secs(t0, tMerged) << " s\n";
+    cout << "Stalls         : router " << feed.consumerWaits() << " empty-feed / " << routerWaits
+         << " full-ring, workers " << workerWaits << " empty-ring polls\n";
+    if (out.is_open()) cout << "Saved merged trades to " << tradesPath << "\n";
+    cout << "==========================\n";
+}
+
+// ---------- Main ----------
+// Usage: orderBook_backtest <events.csv|events.bin> [--convert <out.bin>] [--parse-only]
+//                          [--threads <n>] [--trades <out.csv>]
+//        orderBook_backtest --make-sample <out.csv> <nEvents> <nSymbols> [seed]
+int main(int argc, char** argv) {
+    try {
+        if (argc >= 5 && string(argv[1]) == "--make-sample") {
+            makeSample(argv[2], stoull(argv[3]), stoull(argv[4]), argc > 5 ? stoull(argv[5]) : 1);
+            return 0;
+        }
+        if (argc < 2) {
+            cerr << "usage: orderBook_backtest <events.csv|events.bin> [--convert <out.bin>] [--parse-only]\n"
+                 << "                          [--threads <n>] [--trades <out.csv>]\n"
+                 << "       orderBook_backtest --make-sample <out.csv> <nEvents> <nSymbols> [seed]\n";
+            return 1;
+        }
+
+        string path = argv[1], tradesPath;
+        unsigned nThreads = 0;
+        for (int i = 2; i < argc; ++i) {
+            string arg = argv[i];
+            if (arg == "--convert" && i + 1 < argc) { convert(path, argv[++i]); return 0; }
+            if (arg == "--parse-only") { parseOnly(path); return 0; }
+            if (arg == "--threads" && i + 1 < argc) nThreads = (unsigned)stoul(argv[++i]);
+            if (arg == "--trades" && i + 1 < argc) tradesPath = argv[++i];
+        }
+        if (nThreads || !tradesPath.empty())
+            runParallelBacktest(path, max(1u, nThreads ? nThreads : thread::hardware_concurrency()), tradesPath);
+        else
+            runBacktest(path);
+    } catch (const std::exception& e) {
+        cerr << "Backtest failed: " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -1,13 +1,505 @@
 #include "orderBook_core.hpp"
+#include "orderBook_workload.hpp"
+#include "orderBook_legacy.hpp"
+#include "orderBook_risk.hpp"
 #include <chrono>
 #include <iostream>
 #include <vector>
+#include <map>
 #include <algorithm>
 #include <numeric>
 #include <iomanip>
+#include <string>
+#include <cstdlib>
+#include <new>
 using namespace std;
 
+// ---------- Heap accounting ----------
+// Live heap bytes, for the universe benchmark (the bench is single-threaded)
+static size_t gHeapLive = 0;
+
+void* operator new(size_t n) {
+    size_t* p = (size_t*)malloc(n + 16);
+    if (!p) throw bad_alloc();
+    *p = n;
+    gHeapLive += n;
+    return (char*)p + 16;
+}
+void operator delete(void* p) noexcept {
+    if (!p) return;
+    size_t* h = (size_t*)((uintptr_t)p - 16);
+    gHeapLive -= *h;
+    free(h);
+}
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+
 // ---------- Functional Testcases ----------
+// Rebuilds depth from the level-update stream alone over a random flow
+// (accounts, self-trade prevention, mass cancels, call auctions) and
+// compares it with the book after every command.
+static bool checkLevelUpdates(size_t nOps, uint64_t seed = 11) {
+    Orderbook ob;
+    map<pair<int, Price>, Quantity> depth;
+    ob.SetMarketDataHandler([&](const LevelUpdate* u, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            auto key = make_pair((int)u[i].side, u[i].price);
+            if (u[i].qty) depth[key] = u[i].qty;
+            else depth.erase(key);
+        }
+    });
+    ob.SetSelfTradePrevention(StpMode::Decrement);
+    auto matches = [&] {
+        Levels bids = ob.TopBids(SIZE_MAX), asks = ob.TopAsks(SIZE_MAX);
+        if (bids.size() + asks.size() != depth.size()) return false;
+        for (auto& l : bids) if (depth[{0, l.price}] != l.qty) return false;
+        for (auto& l : asks) if (depth[{1, l.price}] != l.qty) return false;
+        return true;
+    };
+
+    WorkloadConfig cfg;
+    cfg.seed = seed;
+    WorkloadGenerator gen(cfg);
+    Xoshiro256 rng(seed);
+    for (size_t i = 0; i < nOps; ++i) {
+        WorkloadOp op = gen.next();
+        AccountId acct = (AccountId)(1 + rng.below(20));
+        if (i % 5000 == 4000) ob.BeginAuction();          // short call phases
+        if (i % 5000 == 4999) ob.Uncross();
+        if (rng.below(1000) == 0) ob.CancelAllForAccount(acct);
+        else if (op.type == OpType::Add || op.type == OpType::Ioc)
+            ob.AddOrder(ob.MakeOrder(op.type == OpType::Add ? OrderType::GoodTillCancel : OrderType::FillAndKill,
+                                     op.id, op.side, op.px, op.qty, acct));
+        else applyOp(ob, op);
+        if (!matches()) return false;
+    }
+    return true;
+}
+
+// Indicative uncross of a random call phase (adds, cancels, amends, mass
+// cancels) against an uncross worked out here from the full depth, and the
+// handler's last value against the book's, after every command.
+static AuctionResult uncrossFromDepth(const Orderbook& ob, Price ref) {
+    Levels bids = ob.TopBids(SIZE_MAX), asks = ob.TopAsks(SIZE_MAX);
+    map<Price, pair<int64_t, int64_t>> at;                 // price -> buy, sell depth
+    for (auto& l : bids) at[l.price].first = l.qty;
+    for (auto& l : asks) at[l.price].second = l.qty;
+    AuctionResult best;
+    int64_t bestImb = 0;
+    for (auto& [px, d] : at) {
+        int64_t buy = 0, sell = 0;
+        for (auto& l : bids) if (l.price >= px) buy += l.qty;
+        for (auto& l : asks) if (l.price <= px) sell += l.qty;
+        int64_t vol = min(buy, sell), imb = buy - sell;
+        bool better = vol > (int64_t)best.volume ||
+                      (vol == (int64_t)best.volume && vol && llabs(imb) < bestImb);
+        if (!better) continue;
+        best = AuctionResult{px, (uint64_t)vol, imb};
+        bestImb = llabs(imb);
+    }
+    if (!best.volume) return {};
+    // Ties on volume and imbalance: nearest ref, else the middle of the tie
+    vector<Price> tied;
+    for (auto& [px, d] : at) {
+        int64_t buy = 0, sell = 0;
+        for (auto& l : bids) if (l.price >= px) buy += l.qty;
+        for (auto& l : asks) if (l.price <= px) sell += l.qty;
+        if (min(buy, sell) == (int64_t)best.volume && llabs(buy - sell) == bestImb) tied.push_back(px);
+    }
+    if (!ref) ref = tied.front() + (tied.back() - tied.front()) / 2;
+    Price pick = tied.front();
+    for (Price px : tied) if (llabs(px - ref) < llabs(pick - ref)) pick = px;
+    int64_t buy = 0, sell = 0;
+    for (auto& l : bids) if (l.price >= pick) buy += l.qty;
+    for (auto& l : asks) if (l.price <= pick) sell += l.qty;
+    return AuctionResult{pick, best.volume, buy - sell};
+}
+
+static bool checkIndicative(size_t nOps, uint64_t seed = 13) {
+    Orderbook ob;
+    AuctionResult sent;
+    ob.SetIndicativeHandler([&](const AuctionResult& r) { sent = r; });
+    ob.BeginAuction();
+    Xoshiro256 rng(seed);
+    vector<OrderId> ids;
+    auto same = [](const AuctionResult& a, const AuctionResult& b) {
+        return a.price == b.price && a.volume == b.volume && a.imbalance == b.imbalance;
+    };
+    for (size_t i = 0; i < nOps; ++i) {
+        uint64_t r = rng.below(100);
+        if (r < 60 || ids.empty()) {
+            OrderId id = i + 1;
+            Side s = rng.below(2) ? Side::Sell : Side::Buy;
+            ob.AddOrder(ob.MakeOrder(OrderType::GoodTillCancel, id, s, 1000 + (Price)rng.below(40),
+                                     1 + (Quantity)rng.below(50), (AccountId)(1 + rng.below(8))));
+            ids.push_back(id);
+        } else if (r < 85) {
+            size_t k = rng.below(ids.size());
+            ob.CancelOrder(ids[k]);
+            ids[k] = ids.back();
+            ids.pop_back();
+        } else if (r < 99) {
+            ob.ModifyOrder(ids[rng.below(ids.size())], 1000 + (Price)rng.below(40), 1 + (Quantity)rng.below(50));
+        } else {
+            ob.CancelAllForAccount((AccountId)(1 + rng.below(8)));
+        }
+        if (i % 50 == 0 && !same(ob.IndicativeUncross(), uncrossFromDepth(ob, 0))) return false;
+        if (!same(sent, ob.IndicativeUncross())) return false;
+    }
+    return true;
+}
+
+// Expiry wheel against a plain ordered map of expiries: random GTT orders
+// from milliseconds to four months out (past the wheel's top level), some
+// cancelled, and clock steps mostly under a second, now and then months
+static bool checkExpiry(size_t nOps, uint64_t seed = 17) {
+    Orderbook ob;
+    multimap<uint64_t, OrderId> due;
+    map<OrderId, uint64_t> live;
+    Xoshiro256 rng(seed);
+    uint64_t now = 1'000'000'000;
+    ob.AdvanceTime(now);
+    static const uint64_t spans[] = {1'000'000, 1'000'000'000, 3'600'000'000'000, 10'368'000'000'000'000};
+    for (size_t i = 0; i < nOps; ++i) {
+        uint64_t r = rng.below(100);
+        if (r < 60) {
+            OrderId id = i + 1;
+            uint64_t at = now + 1 + rng.below(spans[rng.below(4)]);
+            Side s = rng.below(2) ? Side::Sell : Side::Buy;
+            Price px = s == Side::Buy ? 100 - (Price)rng.below(20) : 101 + (Price)rng.below(20);
+            ob.AddOrder(ob.MakeOrder(OrderType::GoodTillTime, id, s, px, 1, 0, at));
+            due.emplace(at, id);
+            live[id] = at;
+        } else if (r < 70 && !live.empty()) {
+            auto it = live.lower_bound(rng.below(i + 1));
+            if (it == live.end()) continue;
+            ob.CancelOrder(it->first);
+            live.erase(it);
+        } else {
+            now += rng.below(spans[rng.below(r < 99 ? 2 : 4)]);
+            ob.AdvanceTime(now);
+            vector<OrderId> want;
+            while (!due.empty() && due.begin()->first <= now) {
+                if (live.erase(due.begin()->second)) want.push_back(due.begin()->second);
+                due.erase(due.begin());
+            }
+            vector<OrderId> got = ob.LastExpired();
+            sort(want.begin(), want.end());
+            sort(got.begin(), got.end());
+            if (got != want || ob.size() != live.size()) return false;
+        }
+    }
+    return true;
+}
+
+// Stop ladder against a scan: a plain book is fed the same flow while
+// every waiting stop sits in one arrival-order list, searched in full
+// after each order. Fired stops go in buys first by rising trigger, then
+// sells by falling trigger, arrival order within a trigger.
+static bool checkStops(size_t nOps, uint64_t seed = 19) {
+    struct Stop { OrderId id; Side side; Price trigger, limit; Quantity qty; };
+    Orderbook ob, ref;
+    vector<Stop> waiting;
+    Price last = 0;
+    Xoshiro256 rng(seed);
+    auto far = [&](Side s) {
+        Levels l = s == Side::Buy ? ref.TopBids(1000) : ref.TopAsks(1000);
+        return l.empty() ? 0 : l.back().price;
+    };
+    // One order into ref, then the stops its trades (and theirs) reach
+    auto run = [&](OrderType t, OrderId id, Side s, Price px, Quantity q) {
+        Trades all;
+        vector<Stop> fired;
+        Price lo = 0, hi = 0;
+        for (size_t next = 0;;) {
+            for (auto& tr : ref.AddOrder(ref.MakeOrder(t, id, s, px, q))) {
+                last = s == Side::Buy ? tr.ask.price : tr.bid.price;
+                lo = lo ? min(lo, last) : last;
+                hi = max(hi, last);
+                all.push_back(tr);
+            }
+            vector<Stop> buys, sells, rest;
+            for (auto& w : waiting)
+                (w.side == Side::Buy ? (hi && w.trigger <= hi ? buys : rest)
+                                     : (lo && w.trigger >= lo ? sells : rest)).push_back(w);
+            // Ids rise with arrival
+            sort(buys.begin(), buys.end(), [](auto& a, auto& b) { return pair(a.trigger, a.id) < pair(b.trigger, b.id); });
+            sort(sells.begin(), sells.end(), [](auto& a, auto& b) { return pair(b.trigger, a.id) < pair(a.trigger, b.id); });
+            fired.insert(fired.end(), buys.begin(), buys.end());
+            fired.insert(fired.end(), sells.begin(), sells.end());
+            waiting.swap(rest);
+            if (next == fired.size()) break;
+            Stop f = fired[next++];
+            Side opp = f.side == Side::Buy ? Side::Sell : Side::Buy;
+            t = f.limit ? OrderType::GoodTillCancel : OrderType::FillAndKill;
+            id = f.id, s = f.side, px = f.limit ? f.limit : far(opp), q = f.qty;
+        }
+        return all;
+    };
+    auto same = [](const Trades& a, const Trades& b) {
+        return equal(a.begin(), a.end(), b.begin(), b.end(), [](const Trade& x, const Trade& y) {
+            return x.bid.orderId == y.bid.orderId && x.bid.price == y.bid.price && x.bid.qty == y.bid.qty &&
+                   x.ask.orderId == y.ask.orderId && x.ask.price == y.ask.price && x.ask.qty == y.ask.qty;
+        });
+    };
+    for (size_t i = 0; i < nOps; ++i) {
+        OrderId id = i + 1;
+        Side s = rng.below(2) ? Side::Sell : Side::Buy;
+        Price px = 95 + (Price)rng.below(11);
+        Quantity q = 1 + (Quantity)rng.below(20);
+        uint64_t r = rng.below(100);
+        Trades got, want;
+        if (r < 55) {
+            OrderType t = r < 45 ? OrderType::GoodTillCancel : OrderType::FillAndKill;
+            got = ob.AddOrder(ob.MakeOrder(t, id, s, px, q));
+            want = run(t, id, s, px, q);
+        } else if (r < 80) {
+            Price limit = r < 68 ? 0 : px + (s == Side::Buy ? 1 : -1) * (Price)rng.below(3);
+            got = ob.AddOrder(ob.MakeStopOrder(id, s, px, limit, q));
+            if (last && (s == Side::Buy ? last >= px : last <= px))
+                want = run(limit ? OrderType::GoodTillCancel : OrderType::FillAndKill, id, s,
+                           limit ? limit : far(s == Side::Buy ? Side::Sell : Side::Buy), q);
+            else
+                waiting.push_back({id, s, px, limit, q});
+        } else {
+            OrderId victim = 1 + rng.below(id);
+            ob.CancelOrder(victim);
+            auto it = find_if(waiting.begin(), waiting.end(), [&](auto& w) { return w.id == victim; });
+            if (it != waiting.end()) waiting.erase(it);
+            else ref.CancelOrder(victim);
+        }
+        if (!same(got, want) || ob.size() != ref.size() || ob.PendingStops() != waiting.size()) return false;
+    }
+    return true;
+}
+
+// Icebergs against a naive book: every order in one vector with a priority
+// sequence, best found by a full scan, and a replenished peak simply
+// given a new sequence number. Trades and shown/hidden depth must agree.
+static bool checkIcebergs(size_t nOps, uint64_t seed = 23) {
+    struct Naive { OrderId id; Side side; Price px; Quantity shown, hidden, peak; uint64_t seq; };
+    vector<Naive> book;
+    uint64_t seq = 0;
+    auto best = [&](Side s) {
+        auto pick = book.end();
+        for (auto it = book.begin(); it != book.end(); ++it)
+            if (it->side == s && (pick == book.end() || (s == Side::Buy ? it->px > pick->px : it->px < pick->px) ||
+                                  (it->px == pick->px && it->seq < pick->seq)))
+                pick = it;
+        return pick;
+    };
+    auto replenish = [&](Naive& o) {
+        Quantity q = min(o.peak, o.hidden);
+        o.hidden -= q, o.shown = q, o.seq = ++seq;
+    };
+    auto add = [&](OrderType t, OrderId id, Side s, Price px, Quantity qty, Quantity peak) {
+        Trades out;
+        bool shows = peak && peak < qty;
+        Naive in{id, s, px, shows ? peak : qty, shows ? qty - peak : 0, shows ? peak : 0, ++seq};
+        Side opp = s == Side::Buy ? Side::Sell : Side::Buy;
+        for (auto r = best(opp); in.shown && r != book.end() && (s == Side::Buy ? px >= r->px : px <= r->px);
+             r = best(opp)) {
+            Quantity q = min(in.shown, r->shown);
+            in.shown -= q, r->shown -= q;
+            Trade tr = s == Side::Buy ? Trade{{id, px, q}, {r->id, r->px, q}} : Trade{{r->id, r->px, q}, {id, px, q}};
+            out.push_back(tr);
+            if (!r->shown) {
+                if (r->hidden) replenish(*r);
+                else book.erase(r);
+            }
+            if (!in.shown && in.hidden) replenish(in);
+        }
+        if (in.shown && t == OrderType::GoodTillCancel) book.push_back(in);
+        return out;
+    };
+    auto depth = [&](Side s) {
+        map<Price, pair<Quantity, Quantity>> lv;
+        for (auto& o : book)
+            if (o.side == s) lv[o.px].first += o.shown, lv[o.px].second += o.hidden;
+        Levels out;
+        for (auto& [px, q] : lv) out.push_back({px, q.first, q.second});
+        if (s == Side::Buy) reverse(out.begin(), out.end());
+        return out;
+    };
+    auto sameLevels = [](const Levels& a, const Levels& b) {
+        return equal(a.begin(), a.end(), b.begin(), b.end(), [](const LevelInfo& x, const LevelInfo& y) {
+            return x.price == y.price && x.qty == y.qty && x.hidden == y.hidden;
+        });
+    };
+    auto sameTrades = [](const Trades& a, const Trades& b) {
+        return equal(a.begin(), a.end(), b.begin(), b.end(), [](const Trade& x, const Trade& y) {
+            return x.bid.orderId == y.bid.orderId && x.bid.price == y.bid.price && x.bid.qty == y.bid.qty &&
+                   x.ask.orderId == y.ask.orderId && x.ask.price == y.ask.price && x.ask.qty == y.ask.qty;
+        });
+    };
+
+    Orderbook ob;
+    Xoshiro256 rng(seed);
+    for (size_t i = 0; i < nOps; ++i) {
+        OrderId id = i + 1;
+        Side s = rng.below(2) ? Side::Sell : Side::Buy;
+        Price px = 95 + (Price)rng.below(11);
+        Quantity qty = 1 + (Quantity)rng.below(50);
+        uint64_t r = rng.below(100);
+        Trades got, want;
+        if (r < 70) {
+            OrderType t = r < 60 ? OrderType::GoodTillCancel : OrderType::FillAndKill;
+            Quantity peak = t == OrderType::GoodTillCancel && r < 30 ? 1 + (Quantity)rng.below(8) : 0;
+            got = ob.AddOrder(peak ? ob.MakeIcebergOrder(id, s, px, qty, peak) : ob.MakeOrder(t, id, s, px, qty));
+            want = add(t, id, s, px, qty, peak);
+        } else if (!book.empty()) {
+            Naive& v = book[rng.below(book.size())];
+            if (r < 85) {
+                ob.CancelOrder(v.id);
+                book.erase(book.begin() + (&v - book.data()));
+            } else {
+                Quantity open = v.shown + v.hidden, to = 1 + (Quantity)rng.below(open);
+                ob.ModifyOrder(v.id, v.px, to);
+                Quantity cut = open - to, reserve = min(cut, v.hidden);
+                v.hidden -= reserve, v.shown -= cut - reserve;
+            }
+        }
+        if (!sameTrades(got, want) || !sameLevels(ob.TopBids(100), depth(Side::Buy)) ||
+            !sameLevels(ob.TopAsks(100), depth(Side::Sell)))
+            return false;
+    }
+    return true;
+}
+
+// Pegs against a naive book that reprices every pegged order one by one.
+// A group is one queue entry: its orders share a sequence number (and a
+// sub-sequence among themselves), and a move gives them a new one. Trades,
+// depth and the order counts in market data must agree.
+static bool checkPegs(size_t nOps, uint64_t seed = 29) {
+    struct Naive { OrderId id; Side side; Price px; Quantity qty; PegType peg; Price off; uint64_t seq, sub; };
+    struct Group { Price px; uint64_t seq; };
+    vector<Naive> book;
+    map<tuple<Side, PegType, Price>, Group> groups;
+    uint64_t seq = 0;
+    Price litBid = 0, litAsk = 0;
+    auto ahead = [](const Naive& a, const Naive& b) {
+        if (a.px != b.px) return a.side == Side::Buy ? a.px > b.px : a.px < b.px;
+        return pair(a.seq, a.sub) < pair(b.seq, b.sub);
+    };
+    auto best = [&](Side s) {
+        auto pick = book.end();
+        for (auto it = book.begin(); it != book.end(); ++it)
+            if (it->side == s && (pick == book.end() || ahead(*it, *pick))) pick = it;
+        return pick;
+    };
+    auto top = [&](Side s, bool litOnly) {
+        Price px = 0;
+        for (auto& o : book)
+            if (o.side == s && (!litOnly || o.peg == PegType::None) &&
+                (!px || (s == Side::Buy ? o.px > px : o.px < px)))
+                px = o.px;
+        return px;
+    };
+    auto priced = [&](Side s, PegType t, Price off) {
+        Price b = top(Side::Buy, true), a = top(Side::Sell, true);
+        Price ref = s == Side::Buy ? b : a;
+        if (t == PegType::Midpoint) ref = b && a ? (s == Side::Buy ? b + (a - b) / 2 : a - (a - b) / 2) : 0;
+        if (!ref) return 0;
+        Price px = s == Side::Buy ? ref - off : ref + off;
+        Price bid = top(Side::Buy, false), ask = top(Side::Sell, false);
+        if (s == Side::Buy && ask) px = min(px, ask - 1);
+        if (s == Side::Sell && bid) px = max(px, bid + 1);
+        return max<Price>(px, 1);
+    };
+    auto erase = [&](vector<Naive>::iterator it) {
+        auto key = tuple(it->side, it->peg, it->off);
+        bool peg = it->peg != PegType::None;
+        book.erase(it);
+        if (peg && none_of(book.begin(), book.end(), [&](auto& o) { return tuple(o.side, o.peg, o.off) == key; }))
+            groups.erase(key);
+    };
+    auto repeg = [&] {
+        if (groups.empty()) return;
+        Price b = top(Side::Buy, true), a = top(Side::Sell, true);
+        if (b == litBid && a == litAsk) return;
+        litBid = b, litAsk = a;
+        for (auto& [key, g] : groups) {
+            auto [s, t, off] = key;
+            Price px = priced(s, t, off);
+            if (!px || px == g.px) continue;
+            g.px = px, g.seq = ++seq;
+            for (auto& o : book)
+                if (tuple(o.side, o.peg, o.off) == key) o.px = px, o.seq = g.seq;
+        }
+    };
+    auto add = [&](OrderType t, OrderId id, Side s, Price px, Quantity qty) {
+        Trades out;
+        Side opp = s == Side::Buy ? Side::Sell : Side::Buy;
+        for (auto r = best(opp); qty && r != book.end() && (s == Side::Buy ? px >= r->px : px <= r->px); r = best(opp)) {
+            Quantity q = min(qty, r->qty);
+            qty -= q, r->qty -= q;
+            out.push_back(s == Side::Buy ? Trade{{id, px, q}, {r->id, r->px, q}} : Trade{{r->id, r->px, q}, {id, px, q}});
+            if (!r->qty) erase(r);
+        }
+        if (qty && t == OrderType::GoodTillCancel) book.push_back({id, s, px, qty, PegType::None, 0, ++seq, 0});
+        return out;
+    };
+    auto sameTrades = [](const Trades& a, const Trades& b) {
+        return equal(a.begin(), a.end(), b.begin(), b.end(), [](const Trade& x, const Trade& y) {
+            return x.bid.orderId == y.bid.orderId && x.bid.price == y.bid.price && x.bid.qty == y.bid.qty &&
+                   x.ask.orderId == y.ask.orderId && x.ask.price == y.ask.price && x.ask.qty == y.ask.qty;
+        });
+    };
+
+    Orderbook ob;
+    map<pair<Side, Price>, pair<Quantity, uint32_t>> md;   // level -> qty, orders, from updates
+    ob.SetMarketDataHandler([&](const LevelUpdate* u, size_t n) {
+        for (size_t k = 0; k < n; ++k) {
+            if (u[k].qty) md[{u[k].side, u[k].price}] = {u[k].qty, u[k].orders};
+            else md.erase({u[k].side, u[k].price});
+        }
+    });
+    Xoshiro256 rng(seed);
+    for (size_t i = 0; i < nOps; ++i) {
+        OrderId id = i + 1;
+        Side s = rng.below(2) ? Side::Sell : Side::Buy;
+        Price px = 95 + (Price)rng.below(11);
+        Quantity qty = 1 + (Quantity)rng.below(20);
+        uint64_t r = rng.below(100);
+        Trades got, want;
+        if (r < 50) {
+            OrderType t = r < 40 ? OrderType::GoodTillCancel : OrderType::FillAndKill;
+            got = ob.AddOrder(ob.MakeOrder(t, id, s, px, qty));
+            want = add(t, id, s, px, qty);
+        } else if (r < 75) {
+            PegType t = r < 63 ? PegType::Primary : PegType::Midpoint;
+            Price off = (Price)rng.below(4) - 1;
+            got = ob.AddOrder(ob.MakePeggedOrder(id, s, t, off, qty));
+            auto g = groups.find({s, t, off});
+            Price at = g != groups.end() ? g->second.px : priced(s, t, off);
+            if (at) {
+                if (g == groups.end()) g = groups.emplace(tuple(s, t, off), Group{at, ++seq}).first;
+                book.push_back({id, s, at, qty, t, off, g->second.seq, ++seq});
+            }
+            if ((ob.LastReject() == Reject::NoReference) != !at) return false;
+        } else if (!book.empty()) {
+            auto v = book.begin() + (ptrdiff_t)rng.below(book.size());
+            if (r < 90) {
+                ob.CancelOrder(v->id);
+                erase(v);
+            } else {
+                Quantity to = 1 + (Quantity)rng.below(v->qty);
+                ob.ModifyOrder(v->id, v->px, to);
+                v->qty = to;
+                continue;                                    // no touch move, nothing reprices
+            }
+        }
+        repeg();
+        map<pair<Side, Price>, pair<Quantity, uint32_t>> want_md;
+        for (auto& o : book) {
+            auto& l = want_md[{o.side, o.px}];
+            l.first += o.qty;
+            ++l.second;
+        }
+        if (!sameTrades(got, want) || ob.size() != book.size() || md != want_md) return false;
+    }
+    return true;
+}
+
 void runBasicTests(Orderbook& ob) {
     cout << "\n=== FUNCTIONAL TESTS ===\n";
 
@@ -27,6 +519,220 @@ void runBasicTests(Orderbook& ob) {
     ob.CancelOrder(3);
     cout << "Cancelled order #3, book size now = " << ob.size() << "\n";
 
+    // 4. Price bands and circuit breaker on a separate book
+    Orderbook banded;
+    PriceControls pc;
+    pc.staticLo = 50; pc.staticHi = 150;
+    pc.dynamicTicks = 10;
+    pc.haltMoveTicks = 5; pc.haltWindowNs = 1000; pc.haltNs = 5000;
+    banded.SetControls(pc);
+    banded.AddOrder(banded.MakeOrder(OrderType::GoodTillCancel, 1, Side::Sell, 160, 10));
+    bool staticHit = banded.LastReject() == Reject::PriceBand;
+    banded.AddOrder(banded.MakeOrder(OrderType::GoodTillCancel, 2, Side::Buy, 100, 10));
+    banded.AddOrder(banded.MakeOrder(OrderType::GoodTillCancel, 3, Side::Sell, 111, 10));
+    bool dynamicHit = banded.LastReject() == Reject::PriceBand;
+    banded.AddOrder(banded.MakeOrder(OrderType::GoodTillCancel, 4, Side::Sell, 107, 20));
+    banded.AdvanceTime(100);
+    banded.AddOrder(banded.MakeOrder(OrderType::FillAndKill, 5, Side::Sell, 100, 5));
+    banded.AdvanceTime(200);
+    banded.AddOrder(banded.MakeOrder(OrderType::FillAndKill, 6, Side::Buy, 107, 5));   // 100 -> 107
+    bool halted = banded.Halted();
+    banded.AddOrder(banded.MakeOrder(OrderType::GoodTillCancel, 7, Side::Buy, 105, 1));
+    bool haltHit = banded.LastReject() == Reject::Halted;
+    banded.AdvanceTime(5200);
+    // The breaker sees each trade as it prints: a stop's sweep ends at the
+    // trade that halts (101 -> 105), and the stop fired with it waits again
+    Orderbook swept;
+    PriceControls sc;
+    sc.haltMoveTicks = 3; sc.haltWindowNs = 1000; sc.haltNs = 5000;
+    swept.SetControls(sc);
+    swept.AddOrder(swept.MakeOrder(OrderType::GoodTillCancel, 1, Side::Sell, 101, 1));
+    swept.AddOrder(swept.MakeOrder(OrderType::GoodTillCancel, 2, Side::Sell, 102, 1));
+    swept.AddOrder(swept.MakeOrder(OrderType::GoodTillCancel, 3, Side::Sell, 105, 1));
+    swept.AddOrder(swept.MakeOrder(OrderType::GoodTillCancel, 4, Side::Sell, 106, 5));
+    swept.AddOrder(swept.MakeStopOrder(5, Side::Buy, 101, 0, 2));
+    swept.AddOrder(swept.MakeStopOrder(6, Side::Buy, 101, 0, 1));
+    auto cut = swept.AddOrder(swept.MakeOrder(OrderType::GoodTillCancel, 7, Side::Buy, 102, 2));
+    bool sweepCut = cut.size() == 3 && cut.back().ask.price == 105 && swept.Halted() &&
+                    swept.PendingStops() == 1 && swept.BestAsk() == 106 && swept.size() == 1;
+    cout << "Bands: static=" << (staticHit ? "rejected" : "MISSED")
+         << " dynamic=" << (dynamicHit ? "rejected" : "MISSED")
+         << "  breaker: " << (halted && haltHit ? "halted" : "MISSED")
+         << (banded.Halted() ? ", still halted" : ", resumed")
+         << (sweepCut ? ", sweep cut at the halt, 1 stop held" : ", sweep MISSED") << "\n";
+
+    // 5. Per-account risk: account 1 may hold 2 orders and a position of 15
+    RiskLimits lim;
+    lim.maxOpenOrders = 2;
+    lim.maxPosition = 15;
+    RiskBook risk(2, lim);
+    Orderbook rb;
+    rb.SetRisk(&risk);
+    rb.AddOrder(rb.MakeOrder(OrderType::GoodTillCancel, 1, Side::Buy, 100, 10, 1));
+    rb.AddOrder(rb.MakeOrder(OrderType::GoodTillCancel, 2, Side::Buy, 99, 10, 1));
+    bool posHit = rb.LastReject() == Reject::MaxPosition;            // 10 + 10 > 15
+    rb.AddOrder(rb.MakeOrder(OrderType::GoodTillCancel, 3, Side::Buy, 99, 5, 1));
+    rb.AddOrder(rb.MakeOrder(OrderType::GoodTillCancel, 4, Side::Buy, 98, 1, 1));
+    bool openHit = rb.LastReject() == Reject::MaxOpenOrders;
+    rb.AddOrder(rb.MakeOrder(OrderType::FillAndKill, 5, Side::Sell, 100, 4, 2));
+    rb.CancelOrder(3);
+    const AccountState& a1 = risk.account(1);
+    cout << "Risk: position limit " << (posHit ? "rejected" : "MISSED")
+         << ", open-order limit " << (openHit ? "rejected" : "MISSED")
+         << "  account 1 position=" << a1.position << " open=" << a1.openOrders
+         << " openBuy=" << a1.openBuy << "\n";
+
+    // 6. Self-trade prevention: account 7 rests 10 and 5 on the ask, then
+    // buys 12 through both; account 8's 3 lots sit between them
+    static const char* stpNames[] = {"off", "newest", "oldest", "both", "decrement"};
+    cout << "STP:";
+    for (StpMode m : {StpMode::Off, StpMode::CancelNewest, StpMode::CancelOldest,
+                      StpMode::CancelBoth, StpMode::Decrement}) {
+        Orderbook sb;
+        sb.SetSelfTradePrevention(m);
+        sb.AddOrder(sb.MakeOrder(OrderType::GoodTillCancel, 1, Side::Sell, 100, 10, 7));
+        sb.AddOrder(sb.MakeOrder(OrderType::GoodTillCancel, 2, Side::Sell, 100, 3, 8));
+        sb.AddOrder(sb.MakeOrder(OrderType::GoodTillCancel, 3, Side::Sell, 101, 5, 7));
+        auto tr = sb.AddOrder(sb.MakeOrder(OrderType::GoodTillCancel, 4, Side::Buy, 101, 12, 7));
+        Quantity traded = 0;
+        for (auto& t : tr) traded += t.bid.qty;
+        cout << " " << stpNames[(int)m] << "(traded=" << traded << " cancelled=" << sb.LastCancelled().size()
+             << " resting=" << sb.size() << ")";
+    }
+    cout << "\n";
+
+    // 7. Mass cancel: account 5 bids 40 lots over 4 levels next to account 6
+    Orderbook mb;
+    size_t calls = 0, updates = 0;
+    mb.SetMarketDataHandler([&](const LevelUpdate*, size_t n) { ++calls; updates += n; });
+    for (OrderId id = 1; id <= 40; ++id)
+        mb.AddOrder(mb.MakeOrder(OrderType::GoodTillCancel, id, Side::Buy, 90 + (Price)(id % 4), 1, 5));
+    mb.AddOrder(mb.MakeOrder(OrderType::GoodTillCancel, 41, Side::Buy, 91, 1, 6));
+    mb.AddOrder(mb.MakeOrder(OrderType::GoodTillCancel, 42, Side::Sell, 95, 1, 5));
+    calls = updates = 0;
+    auto pulled = mb.CancelAllForAccount(5, Side::Buy);
+    cout << "Mass cancel: pulled " << pulled.size() << " bids in " << calls << " update batch of "
+         << updates << " levels, resting=" << mb.size();
+    calls = 0;
+    mb.ModifyOrder(41, 91, 1);                    // same price and size: a no-op
+    cout << ", unchanged amend " << (calls ? "PUBLISHED" : "silent") << "\n";
+    cout << "Level updates vs book: " << (checkLevelUpdates(200000) ? "consistent" : "MISMATCH") << "\n";
+
+    // 8. Call auction: crossed book bids 10@102 20@101 30@100, asks 15@99
+    // 25@100 10@101; 100 executes 40 with 20 more bid than offered
+    Orderbook ab;
+    ab.BeginAuction();
+    ab.AddOrder(ab.MakeOrder(OrderType::GoodTillCancel, 1, Side::Buy, 102, 10));
+    ab.AddOrder(ab.MakeOrder(OrderType::GoodTillCancel, 2, Side::Buy, 101, 20));
+    ab.AddOrder(ab.MakeOrder(OrderType::GoodTillCancel, 3, Side::Buy, 100, 30));
+    ab.AddOrder(ab.MakeOrder(OrderType::GoodTillCancel, 4, Side::Sell, 99, 15));
+    ab.AddOrder(ab.MakeOrder(OrderType::GoodTillCancel, 5, Side::Sell, 100, 25));
+    ab.AddOrder(ab.MakeOrder(OrderType::GoodTillCancel, 6, Side::Sell, 101, 10));
+    ab.AddOrder(ab.MakeOrder(OrderType::FillAndKill, 7, Side::Buy, 105, 5));
+    bool fakHit = ab.LastReject() == Reject::Auction;
+    AuctionResult ind = ab.IndicativeUncross();
+    Quantity uncrossed = 0;
+    bool onePrice = true;
+    for (auto& t : ab.Uncross()) {
+        uncrossed += t.bid.qty;
+        onePrice = onePrice && t.bid.price == ind.price && t.ask.price == ind.price;
+    }
+    cout << "Auction: indicative " << ind.volume << "@" << ind.price << " imbalance " << ind.imbalance
+         << ", uncrossed " << uncrossed << (onePrice ? " at one price" : " at MIXED prices")
+         << ", FAK " << (fakHit ? "refused" : "MISSED") << ", after: " << ab.BestBid() << "/" << ab.BestAsk()
+         << (ab.InAuction() ? " (still in auction)" : " continuous") << "\n";
+    cout << "Indicative vs depth: " << (checkIndicative(20000) ? "consistent" : "MISMATCH") << "\n";
+
+    // 9. GTT: a bid good until t=2s next to a GTC one; a late GTT is refused
+    Orderbook tb;
+    tb.AdvanceTime(1'000'000'000);
+    tb.AddOrder(tb.MakeOrder(OrderType::GoodTillTime, 1, Side::Buy, 100, 10, 0, 2'000'000'000));
+    tb.AddOrder(tb.MakeOrder(OrderType::GoodTillCancel, 2, Side::Buy, 99, 10));
+    tb.AddOrder(tb.MakeOrder(OrderType::GoodTillDate, 3, Side::Buy, 98, 10, 0, 1'000'000'000));
+    bool lateHit = tb.LastReject() == Reject::Expired;
+    tb.AdvanceTime(1'999'999'999);
+    size_t before = tb.size();
+    tb.AdvanceTime(2'000'000'000);
+    auto hit = tb.AddOrder(tb.MakeOrder(OrderType::FillAndKill, 4, Side::Sell, 99, 5));
+    cout << "GTT: " << before << " resting before expiry, expired " << tb.LastExpired().size()
+         << ", sell hits order " << (hit.empty() ? 0 : hit[0].bid.orderId) << ", late GTD "
+         << (lateHit ? "refused" : "MISSED") << "\n";
+    cout << "Expiry wheel vs ordered map: " << (checkExpiry(300000) ? "consistent" : "MISMATCH") << "\n";
+
+    // 10. Stops: a buy lifts 101 and sets off a market stop at 101, whose
+    // print at 102 sets off a stop-limit at 102 (limit 103)
+    Orderbook sb;
+    for (Price px = 101; px <= 104; ++px) sb.AddOrder(sb.MakeOrder(OrderType::GoodTillCancel, px, Side::Sell, px, 10));
+    sb.AddOrder(sb.MakeStopOrder(1, Side::Buy, 102, 103, 10));
+    sb.AddOrder(sb.MakeStopOrder(2, Side::Buy, 101, 0, 10));
+    sb.AddOrder(sb.MakeStopOrder(3, Side::Sell, 90, 0, 10));
+    size_t waitingBefore = sb.PendingStops();
+    cout << "Stops: " << waitingBefore << " waiting, buy at 101 prints";
+    for (auto& t : sb.AddOrder(sb.MakeOrder(OrderType::FillAndKill, 10, Side::Buy, 101, 10)))
+        cout << " " << t.ask.price << "x" << t.ask.qty;
+    cout << ", " << sb.PendingStops() << " still waiting, best ask " << sb.BestAsk();
+    sb.CancelOrder(3);
+    cout << ", after cancel " << sb.PendingStops() << "\n";
+    cout << "Stop ladder vs scan: " << (checkStops(100000) ? "consistent" : "MISMATCH") << "\n";
+
+    // 11. Iceberg: 50 showing 10, behind it a plain 10 at the same price; a
+    // sell of 25 takes the peak, the plain order, then the next peak
+    Orderbook ib;
+    ib.AddOrder(ib.MakeIcebergOrder(1, Side::Buy, 100, 50, 10));
+    ib.AddOrder(ib.MakeOrder(OrderType::GoodTillCancel, 2, Side::Buy, 100, 10));
+    LevelInfo shown = ib.TopBids(1)[0];
+    cout << "Iceberg: level shows " << shown.qty << " hidden " << shown.hidden << ", sell 25 fills";
+    for (auto& t : ib.AddOrder(ib.MakeOrder(OrderType::FillAndKill, 3, Side::Sell, 100, 25)))
+        cout << " #" << t.bid.orderId << "x" << t.bid.qty;
+    shown = ib.TopBids(1)[0];
+    cout << ", then shows " << shown.qty << " hidden " << shown.hidden << "\n";
+    cout << "Iceberg vs naive book: " << (checkIcebergs(100000) ? "consistent" : "MISMATCH") << "\n";
+
+    // 12. Pegs: two primary-peg bids share one group entry; when a bid
+    // steps up to 101 the group follows it behind that bid, and a midpoint
+    // bid sits at 102 with the midpoint offer held a tick above it
+    Orderbook pb;
+    pb.AddOrder(pb.MakeOrder(OrderType::GoodTillCancel, 1, Side::Buy, 100, 10));
+    pb.AddOrder(pb.MakeOrder(OrderType::GoodTillCancel, 2, Side::Sell, 104, 10));
+    pb.AddOrder(pb.MakePeggedOrder(3, Side::Buy, PegType::Primary, 0, 5));
+    pb.AddOrder(pb.MakePeggedOrder(4, Side::Buy, PegType::Primary, 0, 5));
+    pb.AddOrder(pb.MakePeggedOrder(5, Side::Buy, PegType::Midpoint, 0, 7));
+    pb.AddOrder(pb.MakePeggedOrder(6, Side::Sell, PegType::Midpoint, 0, 7));
+    pb.AddOrder(pb.MakeOrder(OrderType::GoodTillCancel, 7, Side::Buy, 101, 10));
+    cout << "Pegs: bids";
+    for (auto& l : pb.TopBids(3)) cout << " " << l.qty << "@" << l.price;
+    cout << ", midpoint offer @" << pb.BestAsk() << ", sell 30 fills";
+    for (auto& t : pb.AddOrder(pb.MakeOrder(OrderType::FillAndKill, 8, Side::Sell, 101, 30)))
+        cout << " #" << t.bid.orderId << "x" << t.bid.qty << "@" << t.bid.price;
+    // the midpoint offer can be sized down but not repriced or grown
+    Price at = pb.BestAsk();
+    pb.ModifyOrder(6, at + 5, 7);
+    bool moveHit = pb.LastReject() == Reject::PegAmend;
+    pb.ModifyOrder(6, at, 9);
+    bool growHit = pb.LastReject() == Reject::PegAmend;
+    pb.ModifyOrder(6, at, 4);
+    bool cutTaken = pb.LastReject() == Reject::None && pb.TopAsks(1)[0].qty == 4;
+    cout << ", offer reprice " << (moveHit ? "refused" : "MISSED") << ", grow " << (growHit ? "refused" : "MISSED")
+         << ", size-down " << (cutTaken ? "taken" : "MISSED") << "\n";
+    cout << "Pegs vs per-order repricing: " << (checkPegs(100000) ? "consistent" : "MISMATCH") << "\n";
+
+    // 13. Post-only against 100 / 102: a buy at 102 is refused, a sliding
+    // buy at 105 rests at 101, and an amend of a resting post-only offer
+    // down to 100 is refused with the offer left where it was
+    Orderbook qb;
+    qb.AddOrder(qb.MakeOrder(OrderType::GoodTillCancel, 1, Side::Buy, 100, 10));
+    qb.AddOrder(qb.MakeOrder(OrderType::GoodTillCancel, 2, Side::Sell, 102, 10));
+    size_t rejTrades = qb.AddOrder(qb.MakePostOnlyOrder(3, Side::Buy, 102, 10)).size();
+    bool rejHit = qb.LastReject() == Reject::WouldTake && qb.size() == 2;
+    size_t slideTrades = qb.AddOrder(qb.MakePostOnlyOrder(4, Side::Buy, 105, 10, PostOnly::Slide)).size();
+    Price slid = qb.BestBid();
+    qb.AddOrder(qb.MakePostOnlyOrder(5, Side::Sell, 103, 10));
+    qb.ModifyOrder(5, 100, 10);
+    bool amendHit = qb.LastReject() == Reject::WouldTake;
+    cout << "Post-only: cross " << (rejHit && !rejTrades ? "refused" : "MISSED") << ", slide rests at " << slid
+         << (slideTrades ? " (TRADED)" : "") << ", crossing amend " << (amendHit ? "refused" : "MISSED")
+         << ", offers " << qb.TopAsks(2).size() << " from " << qb.BestAsk() << "\n";
+
     cout << "========================\n";
 }
 
@@ -68,10 +774,615 @@ void benchmarkLatency(Orderbook& ob, size_t nOrders = 100000) {
     cout << "==========================\n";
 }
 
+// ---------- Trace Replay Benchmark ----------
+// Replays an op stream (one book per trace symbol); ops are decoded up
+// front so only engine time is measured.
+void benchmarkReplay(const vector<TraceRecord>& recs, const string& label) {
+    size_t nOps = recs.size();
+    vector<WorkloadOp> ops;
+    ops.reserve(nOps);
+    uint32_t maxSym = 0;
+    for (auto& r : recs) {
+        ops.push_back(fromTrace(r));
+        maxSym = max(maxSym, r.symbol);
+    }
+
+    vector<Orderbook> books(maxSym + 1);
+    vector<double> lat[4];
+    for (auto& v : lat) v.reserve(nOps);
+    uint64_t trades = 0;
+
+    auto startAll = chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < nOps; ++i) {
+        const auto& op = ops[i];
+        auto t1 = chrono::high_resolution_clock::now();
+        trades += applyOp(books[recs[i].symbol], op).size();
+        auto t2 = chrono::high_resolution_clock::now();
+        lat[(int)op.type].push_back(chrono::duration<double, nano>(t2 - t1).count());
+    }
+    auto endAll = chrono::high_resolution_clock::now();
+    double totalSec = chrono::duration<double>(endAll - startAll).count();
+
+    size_t resting = 0;
+    for (auto& b : books) resting += b.size();
+
+    static const char* names[4] = {"add", "cancel", "modify", "ioc"};
+    cout << fixed << setprecision(2);
+    cout << "\n=== REPLAY BENCHMARK (" << label << ") ===\n";
+    cout << "Ops tested     : " << nOps << "\n";
+    cout << "Books          : " << books.size() << "\n";
+    cout << "Throughput     : " << (nOps / totalSec) << " ops/sec\n";
+    cout << "Trades         : " << trades << "\n";
+    cout << "Resting orders : " << resting << "\n";
+    for (int k = 0; k < 4; ++k) {
+        auto& v = lat[k];
+        if (v.empty()) continue;
+        sort(v.begin(), v.end());
+        double avg = accumulate(v.begin(), v.end(), 0.0) / v.size();
+        cout << left << setw(7) << names[k] << right << ": n=" << v.size()
+             << " avg=" << avg << "ns p50=" << v[v.size() / 2]
+             << "ns p99=" << v[(size_t)(v.size() * 0.99)] << "ns\n";
+    }
+    cout << "==========================\n";
+}
+
+// ---------- Realistic Flow Benchmark ----------
+void benchmarkWorkload(size_t nOps = 1000000, uint64_t seed = 42, const string& recordPath = "") {
+    WorkloadConfig cfg;
+    cfg.seed = seed;
+    cfg.firstId = 50'000'000;
+    WorkloadGenerator gen(cfg);
+
+    vector<TraceRecord> recs;
+    recs.reserve(nOps);
+    for (size_t i = 0; i < nOps; ++i) recs.push_back(toTrace(gen.next()));
+
+    if (!recordPath.empty()) {
+        TraceWriter w(recordPath);
+        w.write(recs);
+        cout << "\nRecorded " << w.count() << " ops to " << recordPath << "\n";
+    }
+    benchmarkReplay(recs, "workload seed " + to_string(seed));
+}
+
+// ---------- Engine Comparison ----------
+// Replays the same trace through the simulator's former embedded engine
+// and the core engine. The legacy engine has no cancel or modify, so only
+// adds and IOCs are replayed (to both); the rest are counted as skipped.
+struct EngineRun {
+    double seconds = 0;
+    uint64_t trades = 0;
+    size_t resting = 0;
+    vector<double> lat;
+};
+
+static void printEngineRun(const char* name, EngineRun& r, size_t nOps) {
+    sort(r.lat.begin(), r.lat.end());
+    double avg = accumulate(r.lat.begin(), r.lat.end(), 0.0) / max<size_t>(r.lat.size(), 1);
+    cout << left << setw(7) << name << right << ": " << (nOps / r.seconds) << " ops/sec"
+         << " avg=" << avg << "ns p50=" << r.lat[r.lat.size() / 2]
+         << "ns p99=" << r.lat[(size_t)(r.lat.size() * 0.99)] << "ns"
+         << " trades=" << r.trades << " resting=" << r.resting << "\n";
+}
+
+void benchmarkEngines(const vector<TraceRecord>& recs, const string& label) {
+    vector<TraceRecord> ops;
+    ops.reserve(recs.size());
+    uint32_t maxSym = 0;
+    for (auto& r : recs) {
+        if (r.op != (uint8_t)TraceOp::Add && r.op != (uint8_t)TraceOp::Ioc) continue;
+        ops.push_back(r);
+        maxSym = max(maxSym, r.symbol);
+    }
+    if (ops.empty()) {
+        cout << "\nNo add/ioc ops in " << label << " to compare\n";
+        return;
+    }
+
+    EngineRun core, old;
+    core.lat.reserve(ops.size());
+    old.lat.reserve(ops.size());
+    {
+        vector<Orderbook> books(maxSym + 1);
+        auto startAll = chrono::high_resolution_clock::now();
+        for (auto& r : ops) {
+            auto t1 = chrono::high_resolution_clock::now();
+            Orderbook& ob = books[r.symbol];
+            core.trades += ob.AddOrder(ob.MakeOrder(r.op == (uint8_t)TraceOp::Add ? OrderType::GoodTillCancel
+                                                                                  : OrderType::FillAndKill,
+                                                    r.id, r.side ? Side::Sell : Side::Buy, r.px, r.qty)).size();
+            auto t2 = chrono::high_resolution_clock::now();
+            core.lat.push_back(chrono::duration<double, nano>(t2 - t1).count());
+        }
+        core.seconds = chrono::duration<double>(chrono::high_resolution_clock::now() - startAll).count();
+        for (auto& b : books) core.resting += b.size();
+    }
+    {
+        vector<legacy::Orderbook> books(maxSym + 1);
+        auto startAll = chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < ops.size(); ++i) {
+            const auto& r = ops[i];
+            auto t1 = chrono::high_resolution_clock::now();
+            old.trades += books[r.symbol].add({r.id, r.side ? legacy::Side::Sell : legacy::Side::Buy,
+                                               r.op == (uint8_t)TraceOp::Add ? legacy::OrderType::GTC
+                                                                             : legacy::OrderType::IOC,
+                                               r.px, r.qty}, i).size();
+            auto t2 = chrono::high_resolution_clock::now();
+            old.lat.push_back(chrono::duration<double, nano>(t2 - t1).count());
+        }
+        old.seconds = chrono::duration<double>(chrono::high_resolution_clock::now() - startAll).count();
+        for (auto& b : books) old.resting += b.restingOrders();
+    }
+
+    cout << fixed << setprecision(2);
+    cout << "\n=== ENGINE COMPARISON (" << label << ") ===\n";
+    cout << "Ops replayed   : " << ops.size() << " (" << (recs.size() - ops.size())
+         << " cancel/modify skipped)\n";
+    printEngineRun("legacy", old, ops.size());
+    printEngineRun("core", core, ops.size());
+    cout << "Results        : " << (core.trades == old.trades && core.resting == old.resting ? "identical" : "DIFFER")
+         << "\n";
+    cout << "==========================\n";
+}
+
+// Add/IOC-only flow, so both engines see every op
+void benchmarkEngineWorkload(size_t nOps = 1000000, uint64_t seed = 42) {
+    WorkloadConfig cfg;
+    cfg.seed = seed;
+    cfg.firstId = 50'000'000;
+    cfg.addWeight = 0.5;
+    cfg.modifyWeight = 0;
+    cfg.iocWeight = 0.5;
+    cfg.meanLifetime = 0;
+    WorkloadGenerator gen(cfg);
+
+    vector<TraceRecord> recs;
+    recs.reserve(nOps);
+    for (size_t i = 0; i < nOps; ++i) recs.push_back(toTrace(gen.next()));
+    benchmarkEngines(recs, "add/ioc workload seed " + to_string(seed));
+}
+
+// ---------- Risk Overhead ----------
+// The same mixed flow with and without per-account risk checks (limits
+// loose enough that nothing is refused), so the difference is the cost
+// of the checks and counter updates on the entry path.
+static double replayWithAccounts(const vector<WorkloadOp>& ops, RiskBook* risk, size_t nAccounts,
+                                 size_t& resting) {
+    Orderbook ob;
+    ob.SetRisk(risk);
+    auto start = chrono::high_resolution_clock::now();
+    for (auto& op : ops) {
+        AccountId acct = (AccountId)(op.id % nAccounts + 1);
+        switch (op.type) {
+        case OpType::Add:
+            ob.AddOrder(ob.MakeOrder(OrderType::GoodTillCancel, op.id, op.side, op.px, op.qty, acct));
+            break;
+        case OpType::Ioc:
+            ob.AddOrder(ob.MakeOrder(OrderType::FillAndKill, op.id, op.side, op.px, op.qty, acct));
+            break;
+        case OpType::Cancel: ob.CancelOrder(op.id); break;
+        case OpType::Modify: ob.ModifyOrder(op.id, op.px, op.qty); break;
+        }
+    }
+    double sec = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+    resting = ob.size();
+    return sec;
+}
+
+void benchmarkRisk(size_t nOps = 1000000, size_t nAccounts = 1000, uint64_t seed = 42) {
+    WorkloadConfig cfg;
+    cfg.seed = seed;
+    cfg.firstId = 80'000'000;
+    auto ops = WorkloadGenerator(cfg).generate(nOps);
+
+    RiskLimits loose;
+    loose.maxOrderQty = 1'000'000;
+    loose.maxNotional = INT64_MAX / 2;
+    loose.maxOpenOrders = 1'000'000;
+    loose.maxPosition = INT64_MAX / 4;
+    RiskBook risk(nAccounts, loose);
+
+    size_t restingPlain = 0, restingRisk = 0;
+    double plain = replayWithAccounts(ops, nullptr, nAccounts, restingPlain);
+    double checked = replayWithAccounts(ops, &risk, nAccounts, restingRisk);
+
+    // Counters must agree with the book they shadow
+    uint64_t open = 0;
+    int64_t net = 0;
+    for (AccountId a = 1; a <= nAccounts; ++a) {
+        open += risk.account(a).openOrders;
+        net += risk.account(a).position;
+    }
+
+    cout << fixed << setprecision(2);
+    cout << "\n=== RISK CHECK OVERHEAD (" << nAccounts << " accounts) ===\n";
+    cout << "Ops            : " << nOps << "\n";
+    cout << "No risk        : " << (plain / nOps * 1e9) << " ns/op\n";
+    cout << "With risk      : " << (checked / nOps * 1e9) << " ns/op\n";
+    cout << "Overhead       : " << ((checked - plain) / nOps * 1e9) << " ns/op\n";
+    cout << "Counters       : open orders " << open << " vs resting " << restingRisk
+         << ", net position " << net
+         << (open == restingRisk && restingRisk == restingPlain && net == 0 ? " (consistent)" : " (MISMATCH)")
+         << "\n";
+    cout << "==========================\n";
+}
+
+// ---------- Mass Cancel Benchmark ----------
+// Cancel-on-disconnect against a deep book: every session drops in turn,
+// its orders pulled with one CancelAllForAccount call versus one
+// CancelOrder per order, so both ways cancel the whole book in the same
+// order. The call probes the index once per order and lists each level
+// once, so it must come in at or below the per-order time. Figures are
+// per session, the best of alternating runs.
+static void restOrders(Orderbook& ob, size_t nOrders, size_t nSessions) {
+    for (size_t i = 0; i < nOrders; ++i) {
+        Side s = i % 2 ? Side::Sell : Side::Buy;
+        Price px = s == Side::Buy ? 1000 - (Price)(i / 2 % 500) : 1001 + (Price)(i / 2 % 500);
+        ob.AddOrder(ob.MakeOrder(OrderType::GoodTillCancel, i + 1, s, px, 10, (AccountId)(i % nSessions + 1)));
+    }
+}
+
+static bool timeMassCancel(size_t nOrders, size_t nSessions, int runs = 5) {
+    size_t batches[2] = {0, 0}, updates[2] = {0, 0};
+    double usec[2] = {1e300, 1e300};
+    size_t pulled = 0;
+    for (int r = 0; r < 2 * runs; ++r) {
+        int perOrder = (r + r / 2) % 2;   // mass, per-order, per-order, mass, ...
+        Orderbook ob;
+        restOrders(ob, nOrders, nSessions);
+        batches[perOrder] = updates[perOrder] = 0;
+        ob.SetMarketDataHandler([&](const LevelUpdate*, size_t n) {
+            ++batches[perOrder];
+            updates[perOrder] += n;
+        });
+        size_t n = 0;
+        auto start = chrono::high_resolution_clock::now();
+        for (size_t a = 0; a < nSessions; ++a) {
+            if (perOrder) {
+                for (size_t i = a; i < nOrders; i += nSessions) ob.CancelOrder(i + 1);
+            } else {
+                n += ob.CancelAllForAccount((AccountId)(a + 1)).size();
+            }
+        }
+        double us = chrono::duration<double, micro>(chrono::high_resolution_clock::now() - start).count();
+        usec[perOrder] = min(usec[perOrder], us / nSessions);
+        if (!perOrder) pulled = n / nSessions;
+    }
+    bool cheaper = usec[0] <= usec[1];
+    cout << "Session of " << setw(6) << pulled << " : mass " << setw(9) << usec[0] << " us ("
+         << batches[0] / nSessions << " batch, " << updates[0] / nSessions << " levels), per-order "
+         << setw(9) << usec[1] << " us (" << batches[1] / nSessions << " batches)"
+         << (cheaper ? "" : " (SLOWER)") << "\n";
+    return cheaper;
+}
+
+void benchmarkMassCancel(size_t nOrders = 100000) {
+    cout << fixed << setprecision(1);
+    cout << "\n=== MASS CANCEL (" << nOrders << " resting) ===\n";
+    bool cheaper = true;
+    for (size_t sessions : {1, 10, 100, 1000}) cheaper &= timeMassCancel(nOrders, sessions);
+    cout << "Mass vs per-order : " << (cheaper ? "at or below at every size" : "MISMATCH") << "\n";
+    cout << "==========================\n";
+}
+
+// ---------- Auction Uncross Benchmark ----------
+// A closing auction of nOrders random limits spread over nLevels prices
+// around a common center, so most of the ladder is inside the cross. The
+// call phase is built without an indicative feed, with one after every
+// order, and with one per millisecond of book time (an order per us).
+static double buildCallBook(Orderbook& ob, size_t nOrders, Price nLevels, uint64_t seed,
+                            int feed, size_t& sent) {
+    if (feed) ob.SetIndicativeHandler([&](const AuctionResult&) { ++sent; }, feed == 2 ? 1'000'000 : 0);
+    ob.BeginAuction();
+    Xoshiro256 rng(seed);
+    auto start = chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < nOrders; ++i) {
+        Side s = rng.below(2) ? Side::Sell : Side::Buy;
+        Price px = 1000 + (Price)rng.below((uint64_t)nLevels);
+        if (feed == 2) ob.AdvanceTime(i * 1000);
+        ob.AddOrder(ob.MakeOrder(OrderType::GoodTillCancel, i + 1, s, px, 1 + (Quantity)rng.below(100)));
+    }
+    return chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+}
+
+void benchmarkAuction(size_t nOrders = 200000, Price nLevels = 2000, uint64_t seed = 5) {
+    cout << fixed << setprecision(1);
+    cout << "\n=== AUCTION UNCROSS (" << nOrders << " orders, " << nLevels << " levels) ===\n";
+    static const char* feeds[] = {"no indicative", "every order", "every 1 ms"};
+    for (int feed = 0; feed < 3; ++feed) {
+        Orderbook ob;
+        size_t sent = 0;
+        double sec = buildCallBook(ob, nOrders, nLevels, seed, feed, sent);
+        cout << "Call phase, " << left << setw(14) << feeds[feed] << right << ": " << (sec / nOrders * 1e9)
+             << " ns/order, " << sent << " indicatives\n";
+        if (feed) continue;
+
+        auto t0 = chrono::high_resolution_clock::now();
+        AuctionResult r = ob.IndicativeUncross();
+        auto t1 = chrono::high_resolution_clock::now();
+        Trades trades = ob.Uncross();
+        auto t2 = chrono::high_resolution_clock::now();
+        uint64_t executed = 0;
+        for (auto& t : trades) executed += t.bid.qty;
+        cout << "Equilibrium    : " << r.volume << " @ " << r.price << " (imbalance " << r.imbalance << ")\n";
+        cout << "Price search   : " << chrono::duration<double, micro>(t1 - t0).count() << " us\n";
+        cout << "Uncross        : " << chrono::duration<double, micro>(t2 - t1).count() << " us ("
+             << trades.size() << " fills, volume " << executed
+             << (executed == r.volume ? ", matches" : ", MISMATCH") << ")\n";
+        cout << "After          : " << ob.size() << " resting, " << ob.BestBid() << "/" << ob.BestAsk() << "\n";
+    }
+    cout << "==========================\n";
+}
+
+// ---------- Expiry Benchmark ----------
+// End of session: nOrders GTT orders all due at the same instant next to
+// as many GTC orders, so the close removes half the book in one AdvanceTime
+void benchmarkExpiry(size_t nOrders = 100000) {
+    const uint64_t open = 34'200'000'000'000, close = 57'600'000'000'000;   // 09:30, 16:00
+    Orderbook ob;
+    size_t batches = 0, levels = 0;
+    ob.SetMarketDataHandler([&](const LevelUpdate*, size_t n) { ++batches; levels += n; });
+    ob.AdvanceTime(open);
+
+    for (size_t i = 0; i < 2 * nOrders; ++i) {
+        Side s = i % 2 ? Side::Sell : Side::Buy;
+        Price px = s == Side::Buy ? 1000 - (Price)(i / 2 % 500) : 1001 + (Price)(i / 2 % 500);
+        ob.AddOrder(i % 4 < 2 ? ob.MakeOrder(OrderType::GoodTillTime, i + 1, s, px, 10, 0, close)
+                              : ob.MakeOrder(OrderType::GoodTillCancel, i + 1, s, px, 10));
+    }
+
+    auto t0 = chrono::high_resolution_clock::now();
+    ob.AdvanceTime(close - 1);                                   // hours pass, nothing due
+    auto t1 = chrono::high_resolution_clock::now();
+    batches = levels = 0;
+    ob.AdvanceTime(close);
+    auto t2 = chrono::high_resolution_clock::now();
+
+    cout << fixed << setprecision(1);
+    cout << "\n=== SESSION-END EXPIRY (" << nOrders << " GTT + " << nOrders << " GTC) ===\n";
+    cout << "Run-up advance : " << chrono::duration<double, micro>(t1 - t0).count()
+         << " us (6.5 h, timers cascade down, nothing due)\n";
+    cout << "Close advance  : " << chrono::duration<double, micro>(t2 - t1).count() << " us ("
+         << ob.LastExpired().size() << " expired, " << batches << " update batch of " << levels
+         << " levels, " << ob.size() << " left)\n";
+    cout << "==========================\n";
+}
+
+// ---------- Stop Cascade Benchmark ----------
+// One buy lifts the first ask and sets off a chain of market stops, each
+// printing the next level up and so reaching the next stop. Stops that
+// never fire wait on both sides; the chain's cost should not move with
+// how many there are.
+static void timeStopRun(size_t nChain, size_t nIdle) {
+    Orderbook ob;
+    for (size_t k = 0; k <= nChain; ++k)
+        ob.AddOrder(ob.MakeOrder(OrderType::GoodTillCancel, k + 1, Side::Sell, 1001 + (Price)k, 10));
+    OrderId id = nChain + 2;
+    for (size_t k = 0; k < nIdle; ++k) {
+        bool buy = k % 2;
+        ob.AddOrder(ob.MakeStopOrder(id++, buy ? Side::Buy : Side::Sell, buy ? 100000 + (Price)(k % 5000) : 1 + (Price)(k % 500),
+                                     0, 10));
+    }
+    for (size_t k = 0; k < nChain; ++k)
+        ob.AddOrder(ob.MakeStopOrder(id++, Side::Buy, 1001 + (Price)k, 0, 10));
+
+    auto start = chrono::high_resolution_clock::now();
+    Trades trades = ob.AddOrder(ob.MakeOrder(OrderType::FillAndKill, id, Side::Buy, 1001, 10));
+    double usec = chrono::duration<double, micro>(chrono::high_resolution_clock::now() - start).count();
+    cout << "Idle stops " << setw(8) << nIdle << " : " << setw(8) << usec << " us for " << trades.size()
+         << " trades (" << (usec * 1000.0 / nChain) << " ns per stop fired), " << ob.PendingStops()
+         << " left waiting\n";
+}
+
+void benchmarkStops(size_t nChain = 20000) {
+    cout << fixed << setprecision(1);
+    cout << "\n=== STOP CASCADE (" << nChain << " chained stops) ===\n";
+    for (size_t idle : {0, 100000, 1000000}) timeStopRun(nChain, idle);
+    cout << "==========================\n";
+}
+
+// ---------- Iceberg Benchmark ----------
+// A large bid shown `peak` at a time, as one iceberg or sliced into
+// separate GTCs, with a few plain bids at the same price; sells of one
+// peak each then work through the level.
+static void timeIceberg(bool sliced, size_t nSlices, Quantity peak) {
+    Orderbook ob;
+    size_t heap0 = gHeapLive;
+    auto t0 = chrono::high_resolution_clock::now();
+    if (sliced) {
+        for (size_t k = 0; k < nSlices; ++k)
+            ob.AddOrder(ob.MakeOrder(OrderType::GoodTillCancel, k + 1, Side::Buy, 1000, peak));
+    } else {
+        ob.AddOrder(ob.MakeIcebergOrder(1, Side::Buy, 1000, (Quantity)nSlices * peak, peak));
+    }
+    for (OrderId k = 0; k < 10; ++k)
+        ob.AddOrder(ob.MakeOrder(OrderType::GoodTillCancel, nSlices + 1 + k, Side::Buy, 1000, peak));
+    auto t1 = chrono::high_resolution_clock::now();
+    size_t heap = gHeapLive - heap0, resting = ob.size();
+    size_t fills = 0;
+    for (OrderId k = 0; ob.size(); ++k)
+        fills += ob.AddOrder(ob.MakeOrder(OrderType::FillAndKill, 2 * nSlices + k, Side::Sell, 1000, peak)).size();
+    auto t2 = chrono::high_resolution_clock::now();
+    cout << (sliced ? "Sliced GTCs : " : "Iceberg     : ") << setw(8) << chrono::duration<double, micro>(t1 - t0).count()
+         << " us entry, " << setw(7) << resting << " resting, " << setw(6) << heap / 1024 << " KiB, "
+         << setw(6) << (chrono::duration<double, nano>(t2 - t1).count() / fills) << " ns per fill\n";
+}
+
+void benchmarkIceberg(size_t nSlices = 100000, Quantity peak = 100) {
+    cout << fixed << setprecision(1);
+    cout << "\n=== ICEBERG (" << nSlices << " peaks of " << peak << ") ===\n";
+    timeIceberg(false, nSlices, peak);
+    timeIceberg(true, nSlices, peak);
+    cout << "==========================\n";
+}
+
+// ---------- Peg Repricing Benchmark ----------
+// Primary-peg bids spread over nGroups offsets behind a lit book; each
+// round a bid improves the touch and is then cancelled, so every group
+// moves twice. The manual alternative is a cancel/replace per order.
+static double timePegMoves(size_t nPegs, size_t nGroups, bool manual, size_t rounds) {
+    Orderbook ob;
+    for (Price k = 0; k < 50; ++k) {
+        ob.AddOrder(ob.MakeOrder(OrderType::GoodTillCancel, 1 + k, Side::Buy, 1000 - k, 100));
+        ob.AddOrder(ob.MakeOrder(OrderType::GoodTillCancel, 101 + k, Side::Sell, 1010 + k, 100));
+    }
+    const OrderId first = 1000;
+    auto place = [&](size_t k, Price bid) {
+        Price off = (Price)(k % nGroups);
+        return manual ? ob.MakeOrder(OrderType::GoodTillCancel, first + k, Side::Buy, bid - off, 10)
+                      : ob.MakePeggedOrder(first + k, Side::Buy, PegType::Primary, off, 10);
+    };
+    for (size_t k = 0; k < nPegs; ++k) ob.AddOrder(place(k, 1000));
+
+    auto start = chrono::high_resolution_clock::now();
+    for (size_t r = 0; r < rounds; ++r) {
+        for (int step = 0; step < 2; ++step) {
+            Price bid = step ? 1000 : 1001;
+            if (step) ob.CancelOrder(500);
+            else ob.AddOrder(ob.MakeOrder(OrderType::GoodTillCancel, 500, Side::Buy, 1001, 100));
+            if (!manual) continue;
+            for (size_t k = 0; k < nPegs; ++k) {
+                ob.CancelOrder(first + k);
+                ob.AddOrder(place(k, bid));
+            }
+        }
+    }
+    return chrono::duration<double, micro>(chrono::high_resolution_clock::now() - start).count() / (2.0 * rounds);
+}
+
+void benchmarkPegs(size_t nPegs = 100000) {
+    cout << fixed << setprecision(2);
+    cout << "\n=== PEG REPRICING (" << nPegs << " pegged bids) ===\n";
+    for (size_t groups : {1, 10, 100, 1000})
+        cout << "Pegged, " << setw(4) << groups << " offsets : " << setw(10) << timePegMoves(nPegs, groups, false, 1000)
+             << " us per touch move\n";
+    cout << "Cancel/replace each  : " << setw(10) << timePegMoves(nPegs, 10, true, 5) << " us per touch move\n";
+    cout << "==========================\n";
+}
+
+// ---------- Post-Only Benchmark ----------
+// A deep two-sided book; post-only buys priced through the best ask are
+// refused or slid, against a plain GTC at that price that trades and has
+// its ask put back. Refusal should cost about a compare regardless of depth.
+static void timePostOnly(const char* label, size_t nLevels, size_t nOps, int mode) {
+    Orderbook ob;
+    OrderId id = 1;
+    for (Price k = 0; k < (Price)nLevels; ++k)
+        for (int j = 0; j < 10; ++j) {
+            ob.AddOrder(ob.MakeOrder(OrderType::GoodTillCancel, id++, Side::Buy, 100000 - k, 10));
+            ob.AddOrder(ob.MakeOrder(OrderType::GoodTillCancel, id++, Side::Sell, 100001 + k, 10));
+        }
+    auto start = chrono::high_resolution_clock::now();
+    for (size_t k = 0; k < nOps; ++k, ++id) {
+        if (mode == 0) {
+            ob.AddOrder(ob.MakePostOnlyOrder(id, Side::Buy, 100001, 10));
+        } else if (mode == 1) {
+            ob.AddOrder(ob.MakePostOnlyOrder(id, Side::Buy, 100001, 10, PostOnly::Slide));
+            ob.CancelOrder(id);
+        } else {
+            ob.AddOrder(ob.MakeOrder(OrderType::GoodTillCancel, id, Side::Buy, 100001, 10));
+            ob.AddOrder(ob.MakeOrder(OrderType::GoodTillCancel, ++id, Side::Sell, 100001, 10));
+        }
+    }
+    double ns = chrono::duration<double, nano>(chrono::high_resolution_clock::now() - start).count() / nOps;
+    cout << label << setw(8) << nLevels << " levels : " << setw(7) << ns << " ns per order\n";
+}
+
+void benchmarkPostOnly(size_t nOps = 1000000) {
+    cout << fixed << setprecision(1);
+    cout << "\n=== POST-ONLY (" << nOps << " buys at the best ask) ===\n";
+    for (size_t levels : {10, 10000}) {
+        timePostOnly("Refused           ", levels, nOps, 0);
+        timePostOnly("Slid + cancel     ", levels, nOps, 1);
+        timePostOnly("Plain GTC + refill", levels, nOps, 2);
+    }
+    cout << "==========================\n";
+}
+
+// ---------- Universe Memory Benchmark ----------
+// A large instrument universe where most books are idle: memory should
+// follow resting orders, not the number of books.
+static void printUniverse(const char* phase, const vector<Orderbook>& books, size_t bytes) {
+    size_t forms[3] = {0, 0, 0}, orders = 0;
+    for (auto& b : books) {
+        ++forms[(int)b.StorageForm()];
+        orders += b.size();
+    }
+    cout << left << setw(16) << phase << right << ": " << setw(12) << bytes << " bytes ("
+         << (double)bytes / books.size() << "/book) orders=" << orders << " empty=" << forms[0]
+         << " compact=" << forms[1] << " full=" << forms[2] << "\n";
+}
+
+void benchmarkUniverse(size_t nBooks = 100000, double activeShare = 0.01, uint64_t seed = 7) {
+    cout << fixed << setprecision(1);
+    cout << "\n=== UNIVERSE MEMORY (" << nBooks << " books) ===\n";
+    size_t base = gHeapLive;
+    vector<Orderbook> books(nBooks);
+    printUniverse("instantiated", books, gHeapLive - base);
+
+    // Every instrument quoted one lot each side
+    for (size_t i = 0; i < nBooks; ++i) {
+        books[i].AddOrder(books[i].MakeOrder(OrderType::GoodTillCancel, 2 * i + 1, Side::Buy, 99, 1));
+        books[i].AddOrder(books[i].MakeOrder(OrderType::GoodTillCancel, 2 * i + 2, Side::Sell, 101, 1));
+    }
+    printUniverse("quoted", books, gHeapLive - base);
+
+    // A few books see real flow
+    size_t nActive = max<size_t>(1, (size_t)(nBooks * activeShare));
+    for (size_t k = 0; k < nActive; ++k) {
+        WorkloadConfig cfg;
+        cfg.seed = seed + k;
+        cfg.firstId = 1'000'000'000ULL * (k + 1);
+        WorkloadGenerator gen(cfg);
+        Orderbook& b = books[k * (nBooks / nActive)];
+        for (int i = 0; i < 2000; ++i) applyOp(b, gen.next());
+    }
+    printUniverse("active", books, gHeapLive - base);
+
+    // Quotes pulled: idle books give their memory back
+    for (size_t i = 0; i < nBooks; ++i) {
+        books[i].CancelOrder(2 * i + 1);
+        books[i].CancelOrder(2 * i + 2);
+    }
+    printUniverse("quotes pulled", books, gHeapLive - base);
+    cout << "==========================\n";
+}
+
 // ---------- Main ----------
-int main() {
+// Usage: orderBook_bench [--record <trace>] [--replay <trace>] [--compare <trace>]
+int main(int argc, char** argv) {
+    string recordPath, replayPath, comparePath;
+    for (int i = 1; i + 1 < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--record") recordPath = argv[++i];
+        else if (arg == "--replay") replayPath = argv[++i];
+        else if (arg == "--compare") comparePath = argv[++i];
+    }
+
     cout << "=== ORDERBOOK TEST & BENCH ===\n";
+    if (!replayPath.empty() || !comparePath.empty()) {
+        try {
+            if (!replayPath.empty()) benchmarkReplay(loadTrace(replayPath), replayPath);
+            if (!comparePath.empty()) benchmarkEngines(loadTrace(comparePath), comparePath);
+        } catch (const std::exception& e) {
+            cerr << "Replay failed: " << e.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
     Orderbook ob;
     runBasicTests(ob);
     benchmarkLatency(ob, 500000);
+    benchmarkWorkload(1000000, 42, recordPath);
+    benchmarkEngineWorkload(1000000, 42);
+    benchmarkRisk(1000000, 1000);
+    benchmarkMassCancel(100000);
+    benchmarkAuction(200000, 2000);
+    benchmarkExpiry(100000);
+    benchmarkStops(20000);
+    benchmarkIceberg(100000, 100);
+    benchmarkPegs(100000);
+    benchmarkPostOnly(1000000);
+    benchmarkUniverse(100000, 0.01);
 }
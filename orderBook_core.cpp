@@ -1,9 +1,15 @@
 #include "orderBook_core.hpp"
+#include "orderBook_risk.hpp"
 #include <map>
 #include <list>
+#include <deque>
 #include <unordered_map>
 #include <algorithm>
 #include <stdexcept>
+#include <cstdlib>
+#include <memory>
+
+struct PegGroup;
 
 struct Order {
     OrderType type;
@@ -12,108 +18,1583 @@ struct Order {
     Price px;
     Quantity initial;
     Quantity remaining;
+    AccountId account;
+    Price stopPx = 0;            // trigger of a waiting stop; 0 once live
+    uint32_t acctSlot = 0;       // index in its account's order list (full
+                                 // form, non-zero accounts only)
+    uint64_t expireAt = 0;       // GTD/GTT, book time; 0 = never
+    Order* timerPrev = nullptr;  // intrusive expiry-wheel slot list
+    Order* timerNext = nullptr;
+    uint16_t timerSlot = 0;
+    PegType pegType = PegType::None;
+    PostOnly postOnly = PostOnly::Off;
+    Quantity peak = 0;           // iceberg display size (0 = all shown)
+    Quantity hidden = 0;         // iceberg reserve behind `remaining`
+    Price pegOffset = 0;
+    PegGroup* group = nullptr;   // resting peg: its group, whose price is the real one
 
     bool filled() const { return remaining == 0; }
+    Quantity open() const { return remaining + hidden; }
     void fill(Quantity q) {
         if (q > remaining) throw std::logic_error("overfill");
         remaining -= q;
     }
+
+    // Triggered: a stop-limit turns GTC, a stop a FAK limited at `far`
+    void activate(Price far) {
+        if (type == OrderType::Stop) {
+            type = OrderType::FillAndKill;
+            px = far;
+        } else {
+            type = OrderType::GoodTillCancel;
+        }
+        stopPx = 0;
+    }
+};
+
+// Resting pegs of one side, type and offset. They share a price and queue
+// at their level behind one stand-in `entry` (remaining = their total), so
+// repricing the group moves that entry and nothing else. Members are FIFO.
+struct PegGroup {
+    PegType type;
+    Price offset;
+    Order entry{};
+    std::list<Order*> members;
+    std::list<Order*>::iterator it;   // entry's place in its level
+};
+
+namespace {
+constexpr int    kSmallCap  = 8;   // resting orders per side in the compact form
+constexpr size_t kDemoteAt  = 4;   // a full book this small goes back to compact
+constexpr size_t kLadderTicks = 1 << 20;   // widest call book kept per tick
+
+// Uncross price over candidates [0, n) given cumulative buy depth (at or
+// above) and sell depth (at or below): most volume, then least |imbalance|,
+// then nearest ref, else the middle of the tie. ok(k) filters candidates,
+// px(k) is the price. Flat loops over the arrays, so they vectorize.
+template <class Px, class Ok>
+AuctionResult pickUncross(size_t n, const int64_t* buy, const int64_t* sell, Px px, Ok ok, int64_t ref) {
+    AuctionResult r;
+    int64_t vol = 0;
+    for (size_t k = 0; k < n; ++k)
+        if (ok(k)) vol = std::max(vol, std::min(buy[k], sell[k]));
+    if (!vol) return r;
+    auto full = [&](size_t k) { return ok(k) && std::min(buy[k], sell[k]) == vol; };
+    int64_t imb = INT64_MAX;
+    for (size_t k = 0; k < n; ++k)
+        if (full(k)) imb = std::min(imb, std::abs(buy[k] - sell[k]));
+    auto tied = [&](size_t k) { return full(k) && std::abs(buy[k] - sell[k]) == imb; };
+    size_t first = n, last = 0;
+    for (size_t k = 0; k < n; ++k)
+        if (tied(k)) {
+            if (first == n) first = k;
+            last = k;
+        }
+    if (!ref) ref = px(first) + (px(last) - px(first)) / 2;
+    size_t pick = first;
+    for (size_t k = first + 1; k <= last; ++k)
+        if (tied(k) && std::abs(px(k) - ref) < std::abs(px(pick) - ref)) pick = k;
+    r.price = (Price)px(pick);
+    r.volume = (uint64_t)vol;
+    r.imbalance = buy[pick] - sell[pick];
+    return r;
+}
+
+// Peg price from the lit touch, a tick short of the opposite best (pegs
+// included) at most; 0 when the reference is missing
+Price pegAt(Side s, PegType t, Price offset, Price litBid, Price litAsk, Price bid, Price ask) {
+    bool buy = s == Side::Buy;
+    Price ref = buy ? litBid : litAsk;
+    if (t == PegType::Midpoint) {
+        if (!litBid || !litAsk) return 0;
+        ref = buy ? litBid + (litAsk - litBid) / 2 : litAsk - (litAsk - litBid) / 2;
+    }
+    if (!ref) return 0;
+    Price px = buy ? ref - offset : ref + offset;
+    if (buy && ask) px = std::min(px, ask - 1);
+    if (!buy && bid) px = std::max(px, bid + 1);
+    return std::max<Price>(px, 1);
+}
+
+// -------------------- Expiry wheel --------------------
+// Hierarchical timing wheel over book time for GTD/GTT orders: four levels
+// of 256 slots at 2^20 ns (~1 ms) per level-0 slot, so the top level spans
+// ~50 days and anything later waits on an overflow list. Orders are linked
+// into their slot intrusively, so add and remove are O(1). advance() reads
+// the due level-0 slots, moves a higher slot down only when the wheel rolls
+// into it and jumps over empty stretches, so its cost follows the orders
+// due and the slots in use, not the time passed. It never looks at the book.
+class ExpiryWheel {
+public:
+    static constexpr int kBits = 8, kSlots = 1 << kBits, kLevels = 4, kTickShift = 20;
+    static constexpr uint16_t kFar = kLevels * kSlots, kOff = kFar + 1;
+
+    explicit ExpiryWheel(uint64_t now) : cur_(now >> kTickShift) {}
+
+    size_t size() const { return count_; }
+
+    // An empty wheel restarts at the book's clock
+    void restart(uint64_t now) { if (!count_) cur_ = std::max(cur_, now >> kTickShift); }
+
+    void add(Order* o) {
+        ++count_;
+        link(o, slotFor(o->expireAt >> kTickShift));
+    }
+
+    void remove(Order* o) {
+        if (o->timerSlot == kOff) return;   // already taken by advance()
+        --count_;
+        if (o->timerPrev) o->timerPrev->timerNext = o->timerNext;
+        else if (!(head_[o->timerSlot] = o->timerNext) && o->timerSlot < kSlots)
+            occ_[o->timerSlot >> 6] &= ~(1ULL << (o->timerSlot & 63));
+        if (o->timerNext) o->timerNext->timerPrev = o->timerPrev;
+        o->timerSlot = kOff;
+    }
+
+    // Takes every order with expireAt <= now off the wheel and appends its
+    // id, in slot order; the caller then removes them from the book
+    void advance(uint64_t now, std::vector<OrderId>& due) {
+        uint64_t target = now >> kTickShift;
+        if (!count_) { cur_ = std::max(cur_, target); return; }
+        for (;;) {
+            uint64_t base = cur_ & ~(uint64_t)(kSlots - 1);
+            uint64_t last = std::min(target, base + kSlots - 1);
+            for (int s = next(cur_ - base); s >= 0 && base + s <= last; s = next(s + 1))
+                for (Order *o = head_[s], *n; o; o = n) {
+                    n = o->timerNext;
+                    if (o->expireAt > now) continue;
+                    due.push_back(o->id);
+                    remove(o);
+                }
+            if (target <= last) { cur_ = std::max(cur_, target); return; }
+            rollTo(base + kSlots);
+            // Nothing in this block: jump straight to the next slot in use
+            while (!occ_[0] && !occ_[1] && !occ_[2] && !occ_[3]) {
+                uint64_t at = nextInUse();
+                if (at > target) { cur_ = target; return; }
+                rollTo(at);
+            }
+        }
+    }
+
+private:
+    Order* head_[kFar + 1] = {};
+    uint64_t occ_[kSlots / 64] = {};   // level-0 slots in use
+    uint64_t cur_;                     // level-0 slots before this tick are done
+    size_t count_ = 0;
+
+    // Level by the highest tick digit that differs from the current one
+    uint16_t slotFor(uint64_t tick) const {
+        tick = std::max(tick, cur_);
+        for (int l = 0; l < kLevels; ++l)
+            if ((tick >> (kBits * (l + 1))) == (cur_ >> (kBits * (l + 1))))
+                return (uint16_t)(l * kSlots + ((tick >> (kBits * l)) & (kSlots - 1)));
+        return kFar;
+    }
+
+    void link(Order* o, uint16_t slot) {
+        o->timerSlot = slot;
+        o->timerPrev = nullptr;
+        o->timerNext = head_[slot];
+        if (o->timerNext) o->timerNext->timerPrev = o;
+        head_[slot] = o;
+        if (slot < kSlots) occ_[slot >> 6] |= 1ULL << (slot & 63);
+    }
+
+    // Enter the level-0 block starting at tick t: every level whose digit
+    // just changed moves its current slot down, highest first
+    void rollTo(uint64_t t) {
+        cur_ = t;
+        for (int l = kLevels; l >= 1; --l)
+            if (!(cur_ & ((1ULL << (kBits * l)) - 1)))
+                cascade(l == kLevels ? kFar : (uint16_t)(l * kSlots + ((cur_ >> (kBits * l)) & (kSlots - 1))));
+    }
+
+    // Start of the earliest higher slot in use; lower levels always come first
+    uint64_t nextInUse() const {
+        for (int l = 1; l < kLevels; ++l) {
+            uint64_t digit = (cur_ >> (kBits * l)) & (kSlots - 1);
+            for (uint64_t j = digit + 1; j < kSlots; ++j)
+                if (head_[l * kSlots + j])
+                    return (cur_ >> (kBits * (l + 1)) << (kBits * (l + 1))) | (j << (kBits * l));
+        }
+        return head_[kFar] ? ((cur_ >> (kBits * kLevels)) + 1) << (kBits * kLevels) : UINT64_MAX;
+    }
+
+    void cascade(uint16_t slot) {
+        Order* o = head_[slot];
+        head_[slot] = nullptr;
+        while (o) {
+            Order* n = o->timerNext;
+            link(o, slotFor(o->expireAt >> kTickShift));
+            o = n;
+        }
+    }
+
+    // First used level-0 slot at or after s, -1 if none
+    int next(uint64_t s) const {
+        for (uint64_t w = s >> 6; w < kSlots / 64; ++w) {
+            uint64_t bits = occ_[w] & (w == s >> 6 ? ~0ULL << (s & 63) : ~0ULL);
+            if (bits) return (int)(w * 64 + __builtin_ctzll(bits));
+        }
+        return -1;
+    }
+};
+
+// -------------------- Auction depth ladder --------------------
+// Per-tick depth of a book in its call phase, so the indicative uncross
+// follows adds and cancels instead of being re-derived from the level maps.
+// Bid and ask depth sit in Fenwick trees: a change is O(log n) and so is
+// the solve. Cumulative buy depth B(k) (at or above tick k) only falls with
+// k and sell depth S(k) (at or below) only rises, so B - S never rises.
+// Volume min(B, S) is then S up to the tick t where B - S turns negative
+// and B from there on. The most volume is at the last tick with depth
+// before t or the first from t, and a tie on both volume and imbalance can
+// only pair each with the next tick with depth beyond it. One descent finds
+// t, one each those ticks, and pickUncross ranks the four at most. A book
+// that spans more than kLadderTicks goes back to the maps.
+struct AuctionLadder {
+    Price base = 0;
+    std::vector<int64_t> bid, ask;         // raw depth per tick
+    std::vector<int64_t> bidT, askT;       // Fenwick trees over them, 1-based
+    int64_t totalBid = 0;
+    size_t top = 0;                        // highest power of two <= size
+    bool dense = true;
+    bool changed = false;                  // since the last indicative
+
+    size_t size() const { return bid.size(); }
+
+    void add(Side s, Price px, int64_t d) {
+        changed = true;
+        if (!dense || !cover(px)) return;
+        size_t k = (size_t)(px - base);
+        auto& raw = s == Side::Buy ? bid : ask;
+        auto& tree = s == Side::Buy ? bidT : askT;
+        raw[k] += d;
+        if (s == Side::Buy) totalBid += d;
+        for (size_t i = k + 1; i < tree.size(); i += i & (0 - i)) tree[i] += d;
+    }
+
+    // Widen to include px, with room to grow on that side
+    bool cover(Price px) {
+        int64_t lo = base, hi = (int64_t)base + (int64_t)size() - 1;
+        if (size() && px >= lo && px <= hi) return true;
+        int64_t pad = std::max<int64_t>(64, (hi - lo + 1) / 2);
+        int64_t nlo = size() && px > hi ? lo : px - pad;
+        int64_t nhi = size() && px < lo ? hi : px + pad;
+        if ((uint64_t)(nhi - nlo + 1) > kLadderTicks) {
+            dense = false;
+            bid = ask = bidT = askT = {};
+            return false;
+        }
+        size_t n = (size_t)(nhi - nlo + 1), off = size() ? (size_t)(lo - nlo) : 0;
+        std::vector<int64_t> nb(n), na(n);
+        std::copy(bid.begin(), bid.end(), nb.begin() + off);
+        std::copy(ask.begin(), ask.end(), na.begin() + off);
+        bid.swap(nb);
+        ask.swap(na);
+        build(bidT, bid);
+        build(askT, ask);
+        base = (Price)nlo;
+        for (top = 1; top * 2 <= n; top *= 2) {}
+        return true;
+    }
+
+    static void build(std::vector<int64_t>& tree, const std::vector<int64_t>& raw) {
+        tree.assign(raw.size() + 1, 0);
+        for (size_t i = 1; i < tree.size(); ++i) {
+            tree[i] += raw[i - 1];
+            size_t j = i + (i & (0 - i));
+            if (j < tree.size()) tree[j] += tree[i];
+        }
+    }
+
+    // Depth of the first m ticks
+    static int64_t prefix(const std::vector<int64_t>& tree, size_t m) {
+        int64_t sum = 0;
+        for (; m; m &= m - 1) sum += tree[m];
+        return sum;
+    }
+
+    // Most ticks m whose bid and ask depth together is at most x
+    size_t lift(int64_t x) const {
+        size_t m = 0;
+        for (size_t step = top; step; step >>= 1)
+            if (m + step < bidT.size() && bidT[m + step] + askT[m + step] <= x) {
+                m += step;
+                x -= bidT[m] + askT[m];
+            }
+        return m;
+    }
+
+    // Nearest tick with depth at or below / at or above k; size() if none
+    size_t depthAtOrBelow(size_t k) const {
+        int64_t d = prefix(bidT, k + 1) + prefix(askT, k + 1);
+        return d ? lift(d - 1) : size();
+    }
+    size_t depthAtOrAbove(size_t k) const {
+        return k < size() ? lift(prefix(bidT, k) + prefix(askT, k)) : size();
+    }
+
+    AuctionResult solve(Price lo, Price hi, Price ref) {
+        size_t l = (size_t)(lo - base), h = (size_t)(hi - base), n = size();
+        // t: the first tick where buy depth at or above falls below sell at or below
+        size_t t = lift(totalBid);
+        if (t < n && prefix(bidT, t) + prefix(askT, t + 1) <= totalBid) ++t;
+
+        size_t near[4], m = 0;
+        size_t below = t ? depthAtOrBelow(t - 1) : n;
+        size_t above = depthAtOrAbove(t);
+        if (below < n && below) near[m++] = depthAtOrBelow(below - 1);
+        if (below < n) near[m++] = below;
+        if (above < n) near[m++] = above;
+        if (above < n) near[m++] = depthAtOrAbove(above + 1);
+
+        int64_t buy[4], sell[4];
+        size_t k[4], c = 0;
+        for (size_t i = 0; i < m; ++i) {
+            if (near[i] >= n || near[i] < l || near[i] > h) continue;
+            k[c] = near[i];
+            buy[c] = totalBid - prefix(bidT, k[c]);
+            sell[c] = prefix(askT, k[c] + 1);
+            ++c;
+        }
+        return pickUncross(c, buy, sell, [&](size_t i) { return (int64_t)base + (int64_t)k[i]; },
+                           [](size_t) { return true; }, ref);
+    }
+};
+}
+
+// -------------------- Entry controls --------------------
+// Price bands, breaker state, risk and market-data hooks of one book.
+struct Orderbook::Controls {
+    PriceControls cfg;
+    RiskBook* risk = nullptr;
+    StpMode   stp = StpMode::Off;
+    std::vector<OrderId> stpCancelled;   // by the last AddOrder/ModifyOrder
+    std::vector<OrderId> expired;        // by the last AdvanceTime
+    uint64_t now = 0;
+    uint64_t haltedUntil = 0;
+    bool     halted = false;
+    bool     auction = false;             // call phase: rest, don't match
+    Price    lastTrade = 0;
+    Price    runLo = 0, runHi = 0;        // trade prices of the current command
+    Price    sweepLo = 0, sweepHi = 0;    // band the current sweep prints in (0: open)
+
+    // Levels changed by the current command; published once each at its end.
+    // mark() lists a level once per command however often it changes: the
+    // level keeps the epoch of the last command that listed it.
+    LevelUpdateFn md;
+    std::vector<std::pair<Side, Price>> dirty;
+    std::vector<LevelUpdate> updates;
+    uint64_t mdEpoch = 1;
+
+    // Indicative uncross during a call phase, throttled on book time
+    IndicativeFn  indicative;
+    uint64_t      indicativeEveryNs = 0;
+    uint64_t      nextIndicative = 0;
+    AuctionResult lastIndicative;
+
+    void touch(Side s, Price px) { if (md) dirty.emplace_back(s, px); }
+
+    template <class Level>
+    void mark(Level& l, Side s, Price px) {
+        if (!md || l.mdEpoch == mdEpoch) return;
+        l.mdEpoch = mdEpoch;
+        dirty.emplace_back(s, px);
+    }
+
+    // Monotonic deques over the breaker window: highs holds decreasing
+    // prices, lows increasing ones, so the window's range is front - front
+    // and each trade is pushed and popped at most once.
+    struct Tick { uint64_t t; Price px; };
+    std::deque<Tick> highs, lows;
+
+    // The dynamic band's reference: the last trade, else the touch
+    Price reference(Price bid, Price ask) const {
+        return lastTrade ? lastTrade : bid && ask ? bid + (ask - bid) / 2 : bid ? bid : ask;
+    }
+
+    Reject screen(Price px, Price bid, Price ask) const {
+        if (halted) return Reject::Halted;
+        if (px < cfg.staticLo || (cfg.staticHi && px > cfg.staticHi)) return Reject::PriceBand;
+        if (cfg.dynamicTicks) {
+            Price ref = reference(bid, ask);
+            if (ref && (px > ref + cfg.dynamicTicks || px < ref - cfg.dynamicTicks)) return Reject::PriceBand;
+        }
+        return Reject::None;
+    }
+
+    // Fix the band a sweep entering now may print in. Entry screening keeps
+    // a limit inside it already; a fired stop, a market order at the far
+    // end, is held to it here.
+    void bound(Price bid, Price ask) {
+        sweepLo = cfg.staticLo;
+        sweepHi = cfg.staticHi;
+        Price ref = cfg.dynamicTicks ? reference(bid, ask) : 0;
+        if (!ref) return;
+        sweepLo = std::max(sweepLo, ref - cfg.dynamicTicks);
+        sweepHi = sweepHi ? std::min(sweepHi, ref + cfg.dynamicTicks) : ref + cfg.dynamicTicks;
+    }
+
+    // A sweep stops before a print outside its band or once the breaker trips
+    bool stops(Price px) const { return halted || px < sweepLo || (sweepHi && px > sweepHi); }
+
+    void expire() {
+        while (!highs.empty() && highs.front().t + cfg.haltWindowNs < now) highs.pop_front();
+        while (!lows.empty() && lows.front().t + cfg.haltWindowNs < now) lows.pop_front();
+    }
+
+    void onTrade(Price px) {
+        lastTrade = px;
+        runLo = runLo ? std::min(runLo, px) : px;
+        runHi = std::max(runHi, px);
+        if (!cfg.haltMoveTicks) return;
+        while (!highs.empty() && highs.back().px <= px) highs.pop_back();
+        while (!lows.empty() && lows.back().px >= px) lows.pop_back();
+        highs.push_back({now, px});
+        lows.push_back({now, px});
+        if (highs.front().px - lows.front().px > cfg.haltMoveTicks) {
+            halted = true;
+            haltedUntil = now + cfg.haltNs;
+            highs.clear();
+            lows.clear();
+        }
+    }
 };
 
-// -------------------- Implementation --------------------
+// -------------------- Implementation (full form) --------------------
 struct Orderbook::Impl {
     using OrderPtr = Order*;
     using Q = std::list<OrderPtr>;
 
-    std::map<Price, Q, std::greater<Price>> bids;
-    std::map<Price, Q, std::less<Price>>    asks;
-    std::unordered_map<OrderId, std::pair<OrderPtr, Q::iterator>> lookup;
+    // A price level keeps its open quantity, shown and iceberg reserve, so
+    // depth reads never walk orders. A peg group is one entry in `orders`
+    // standing for `pegged` of them.
+    struct Level {
+        Q orders;
+        Quantity qty = 0;
+        Quantity hidden = 0;
+        uint32_t groups = 0, pegged = 0;
+        uint64_t mdEpoch = 0;   // last command that listed it for market data
+
+        uint32_t count() const { return (uint32_t)orders.size() - groups + pegged; }
+    };
+    struct Loc {
+        OrderPtr o;
+        Q::iterator it;   // a peg's is in its group's member list
+        Level* lvl;       // map nodes are stable while the level has orders; null for pegs
+    };
+
+    std::map<Price, Level, std::greater<Price>> bids;
+    std::map<Price, Level, std::less<Price>>    asks;
+    std::unordered_map<OrderId, Loc> lookup;
+    std::vector<std::vector<OrderPtr>> accountOrders[2];   // [side][account], unordered
+    std::unique_ptr<AuctionLadder> ladder;      // call phase only
+    std::unique_ptr<ExpiryWheel> wheel;         // once a GTD/GTT order rests
+    size_t icebergs = 0;                        // resting, kept out of the compact form
+
+    // Waiting stops, off the visible book: per side by trigger, the one a
+    // rising (buys) or falling (sells) price reaches first at begin()
+    std::map<Price, Level, std::less<Price>>    buyStops;
+    std::map<Price, Level, std::greater<Price>> sellStops;
+    std::unordered_map<OrderId, Loc> stopLookup;
+
+    // Peg groups per side by (type, offset), and the lit touch they were
+    // last priced from
+    std::map<std::pair<PegType, Price>, PegGroup> pegs[2];
+    Price pegBid = 0, pegAsk = 0;
+
+    ~Impl() {
+        for (auto& kv : lookup) delete kv.second.o;
+        for (auto& kv : stopLookup) delete kv.second.o;
+    }
+
+    // Per-account lists and the expiry wheel. An account's list is a flat
+    // array (removal swaps the last order in), so a mass cancel reads every
+    // order's address up front rather than chasing one pointer per order.
+    void link(Order* o) {
+        if (o->expireAt) wheel->add(o);
+        icebergs += o->peak != 0;
+        if (!o->account) return;
+        auto& lists = accountOrders[(int)o->side];
+        if (lists.size() <= o->account) lists.resize(o->account + 1);
+        o->acctSlot = (uint32_t)lists[o->account].size();
+        lists[o->account].push_back(o);
+    }
+
+    void unlink(Order* o) {
+        if (o->expireAt) wheel->remove(o);
+        icebergs -= o->peak != 0;
+        if (!o->account) return;
+        auto& mine = accountOrders[(int)o->side][o->account];
+        Order* last = mine.back();
+        mine[o->acctSlot] = last;
+        last->acctSlot = o->acctSlot;
+        mine.pop_back();
+    }
+
+    Level& level(Side s, Price px) { return s == Side::Buy ? bids[px] : asks[px]; }
+
+    void eraseLevel(Side s, Price px) {
+        if (s == Side::Buy) bids.erase(px);
+        else asks.erase(px);
+    }
+
+    // Only the full form can hold these
+    bool pinned() const {
+        return !stopLookup.empty() || (wheel && wheel->size()) || icebergs || !pegs[0].empty() || !pegs[1].empty();
+    }
+
+    Level& levelOf(Order* o) {
+        return o->group ? level(o->side, o->group->entry.px) : *lookup.find(o->id)->second.lvl;
+    }
+
+    void insert(Order* o) {
+        if (o->pegType != PegType::None) { joinPeg(o); return; }
+        Level& l = (o->side == Side::Buy) ? bids[o->px] : asks[o->px];
+        l.orders.push_back(o);
+        l.qty += o->remaining;
+        l.hidden += o->hidden;
+        lookup.emplace(o->id, Loc{o, std::prev(l.orders.end()), &l});
+        link(o);
+        if (ladder) ladder->add(o->side, o->px, o->open());
+    }
+
+    // A peg joins the back of its group, which a new group's entry opens at
+    // the back of the level priced for it (o->px)
+    void joinPeg(Order* o) {
+        auto [git, fresh] = pegs[(int)o->side].try_emplace({o->pegType, o->pegOffset});
+        PegGroup& g = git->second;
+        if (fresh) {
+            g.type = o->pegType;
+            g.offset = o->pegOffset;
+            g.entry.side = o->side;
+            g.entry.px = o->px;
+            g.entry.group = &g;
+        }
+        o->px = g.entry.px;
+        Level& l = level(o->side, o->px);
+        if (fresh) {
+            l.orders.push_back(&g.entry);
+            g.it = std::prev(l.orders.end());
+            ++l.groups;
+        }
+        g.members.push_back(o);
+        o->group = &g;
+        g.entry.remaining += o->remaining;
+        l.qty += o->remaining;
+        ++l.pegged;
+        lookup.emplace(o->id, Loc{o, std::prev(g.members.end()), nullptr});
+        link(o);
+        if (ladder) ladder->add(o->side, o->px, o->remaining);
+    }
+
+    // A peg leaves its group; the last one out takes the group's entry
+    void leavePeg(Order* o, Q::iterator it, Level& l) {
+        PegGroup* g = o->group;
+        l.qty -= o->remaining;
+        --l.pegged;
+        g->entry.remaining -= o->remaining;
+        g->members.erase(it);
+        if (!g->members.empty()) return;
+        l.orders.erase(g->it);
+        --l.groups;
+        pegs[(int)o->side].erase({g->type, g->offset});
+    }
+
+    // Level at px, stepped to from near when px lies a few levels on (as
+    // it does for the next group in a repeg pass), else searched for;
+    // created if missing
+    template <class Book>
+    static typename Book::iterator seek(Book& book, typename Book::iterator near, Price px) {
+        for (int k = 0; k < 4 && near != book.end() && book.key_comp()(near->first, px); ++k) ++near;
+        if (near != book.end() && near->first == px) return near;
+        return book.try_emplace(near, px);
+    }
+
+    // Move a group's entry from its level to the back of the level at px,
+    // and with it every order in the group; from and to are left on the
+    // level after the one left and on the one moved to
+    template <class Book>
+    void moveGroup(Book& book, PegGroup& g, Price px, typename Book::iterator& from,
+                   typename Book::iterator& to, Controls* ctl) {
+        Side s = g.entry.side;
+        from = seek(book, from, g.entry.px);
+        to = seek(book, to, px);
+        Level& l = from->second;
+        Level& dst = to->second;
+        dst.orders.splice(dst.orders.end(), l.orders, g.it);
+        l.qty -= g.entry.remaining;
+        dst.qty += g.entry.remaining;
+        l.pegged -= (uint32_t)g.members.size();
+        dst.pegged += (uint32_t)g.members.size();
+        --l.groups;
+        ++dst.groups;
+        if (ctl) {
+            ctl->touch(s, g.entry.px);
+            ctl->touch(s, px);
+        }
+        if (l.orders.empty()) from = book.erase(from);
+        g.entry.px = px;
+    }
+
+    // Best price with an unpegged order; walks past levels holding only
+    // peg groups, so at most one step per group
+    template <class Book>
+    static Price litBest(const Book& book) {
+        for (auto& [px, l] : book)
+            if (l.orders.size() > l.groups) return px;
+        return 0;
+    }
+
+    Price pegPrice(Side s, PegType t, Price offset) const {
+        return pegAt(s, t, offset, litBest(bids), litBest(asks));
+    }
+
+    // Peg price against a lit touch the caller already has; O(1)
+    Price pegAt(Side s, PegType t, Price offset, Price litBid, Price litAsk) const {
+        return ::pegAt(s, t, offset, litBid, litAsk, bids.empty() ? 0 : bids.begin()->first,
+                       asks.empty() ? 0 : asks.begin()->first);
+    }
+
+    // When the lit touch has moved, each group takes its new price in one
+    // move of its entry: the cost is per group (side, type and offset), not
+    // per pegged order. The lit touch is read once, as moving groups never
+    // changes it, and groups come in offset order, so each finds its levels
+    // a step or two from the last group's. Bids go first, so asks stop
+    // short of them.
+    void repeg(Controls* ctl) {
+        Price bid = litBest(bids), ask = litBest(asks);
+        if (bid == pegBid && ask == pegAsk) return;
+        pegBid = bid;
+        pegAsk = ask;
+        repegSide(bids, pegs[(int)Side::Buy], bid, ask, ctl);
+        repegSide(asks, pegs[(int)Side::Sell], bid, ask, ctl);
+    }
+
+    template <class Book>
+    void repegSide(Book& book, std::map<std::pair<PegType, Price>, PegGroup>& pool, Price bid, Price ask,
+                   Controls* ctl) {
+        auto from = book.begin(), to = book.begin();
+        for (auto& [key, g] : pool) {
+            Price px = pegAt(g.entry.side, g.type, g.offset, bid, ask);
+            if (px && px != g.entry.px) moveGroup(book, g, px, from, to, ctl);
+        }
+    }
+
+    // Unlink and free a resting order; false if the id is unknown
+    bool cancel(OrderId id) {
+        auto it = lookup.find(id);
+        if (it == lookup.end()) return false;
+        Loc loc = it->second;
+        lookup.erase(it);
+        drop(loc);
+        return true;
+    }
+
+    // Unlink and free an order already taken out of the index
+    void drop(const Loc& loc) {
+        Order* o = loc.o;
+        if (o->group) {
+            Price px = o->group->entry.px;
+            Level& l = level(o->side, px);
+            leavePeg(o, loc.it, l);
+            if (l.orders.empty()) eraseLevel(o->side, px);
+            unlink(o);
+            if (ladder) ladder->add(o->side, px, -(int64_t)o->remaining);
+            delete o;
+            return;
+        }
+        loc.lvl->qty -= o->remaining;
+        loc.lvl->hidden -= o->hidden;
+        loc.lvl->orders.erase(loc.it);
+        if (loc.lvl->orders.empty()) {
+            if (o->side == Side::Buy) bids.erase(o->px);
+            else asks.erase(o->px);
+        }
+        unlink(o);
+        if (ladder) ladder->add(o->side, o->px, -(int64_t)o->open());
+        delete o;
+    }
+
+    // Pull account a's orders on side s straight off its list: one index
+    // probe per order and each level listed for market data once, so the
+    // batch costs less than cancelling the same orders one at a time
+    void cancelAccount(AccountId a, int s, Controls* ctl, std::vector<OrderId>& ids) {
+        if (a >= accountOrders[s].size()) return;
+        std::vector<OrderPtr> mine;
+        mine.swap(accountOrders[s][a]);
+        for (Order* o : mine) {
+            ids.push_back(o->id);
+            if (ctl && ctl->risk) ctl->risk->onRelease(o->account, o->side, o->open(), true);
+            o->account = 0;                            // already off the list
+            if (o->stopPx) {                           // waiting stop: unseen, nothing to publish
+                delete disarmStop(o->id);
+                continue;
+            }
+            auto it = lookup.find(o->id);
+            Loc loc = it->second;
+            lookup.erase(it);
+            if (ctl) {
+                if (loc.lvl) ctl->mark(*loc.lvl, o->side, o->px);
+                else ctl->touch(o->side, o->group->entry.px);
+            }
+            drop(loc);
+        }
+    }
+
+    // Move a resting order (not a peg) to the back of another price
+    void reprice(Order* o, Price px) {
+        auto it = lookup.find(o->id);
+        Loc loc = it->second;
+        lookup.erase(it);
+        loc.lvl->qty -= o->remaining;
+        loc.lvl->hidden -= o->hidden;
+        loc.lvl->orders.erase(loc.it);
+        if (loc.lvl->orders.empty()) eraseLevel(o->side, o->px);
+        unlink(o);
+        if (ladder) ladder->add(o->side, o->px, -(int64_t)o->open());
+        o->px = px;
+        insert(o);
+    }
+
+    void armStop(Order* o) {
+        Level& l = o->side == Side::Buy ? buyStops[o->stopPx] : sellStops[o->stopPx];
+        l.orders.push_back(o);
+        l.qty += o->remaining;
+        stopLookup.emplace(o->id, Loc{o, std::prev(l.orders.end()), &l});
+        link(o);
+    }
+
+    // Unlink (not free) a waiting stop; nullptr if the id is unknown
+    Order* disarmStop(OrderId id) {
+        auto it = stopLookup.find(id);
+        if (it == stopLookup.end()) return nullptr;
+        Loc loc = it->second;
+        stopLookup.erase(it);
+        Order* o = loc.o;
+        loc.lvl->qty -= o->remaining;
+        loc.lvl->orders.erase(loc.it);
+        if (loc.lvl->orders.empty()) {
+            if (o->side == Side::Buy) buyStops.erase(o->stopPx);
+            else sellStops.erase(o->stopPx);
+        }
+        unlink(o);
+        return o;
+    }
+
+    // Append every stop that trade prices [lo, hi] reached, nearest trigger
+    // first and FIFO within one. Only the ends of the two lists are read,
+    // so the cost is O(stops fired), plus two compares when none is.
+    void fireStops(Price lo, Price hi, std::vector<Order*>& out) {
+        auto take = [&](auto& stops, auto reached) {
+            while (!stops.empty() && reached(stops.begin()->first)) {
+                for (Order* o : stops.begin()->second.orders) {
+                    stopLookup.erase(o->id);
+                    unlink(o);
+                    out.push_back(o);
+                }
+                stops.erase(stops.begin());
+            }
+        };
+        take(buyStops, [&](Price t) { return t <= hi; });
+        take(sellStops, [&](Price t) { return t >= lo; });
+    }
+
+    template <class Book>
+    static Levels top(const Book& book, size_t n) {
+        Levels out;
+        for (auto it = book.begin(); it != book.end() && out.size() < n; ++it)
+            out.push_back({it->first, it->second.qty, it->second.hidden});
+        return out;
+    }
+
+    // An iceberg whose shown peak is used up shows the next one from its
+    // reserve and goes to the back of its level. The list node is spliced,
+    // not reallocated, so its lookup entry stays valid as it is.
+    static bool replenish(Order* o, Level& l) {
+        if (!o->hidden) return false;
+        Quantity q = std::min(o->peak, o->hidden);
+        o->hidden -= q;
+        o->remaining = q;
+        l.hidden -= q;
+        l.qty += q;
+        l.orders.splice(l.orders.end(), l.orders, l.orders.begin());
+        return true;
+    }
+
+    // The order at the front of a level: a peg group's entry stands for its
+    // oldest member, at the group's price
+    static Order* head(Level& l) {
+        Order* o = l.orders.front();
+        if (PegGroup* g = o->group; g && o == &g->entry) {
+            o = g->members.front();
+            o->px = g->entry.px;
+        }
+        return o;
+    }
+
+    static void take(Level& l, Order* o, Quantity q) {
+        l.qty -= q;
+        if (o->group) o->group->entry.remaining -= q;
+    }
+
+    // A done order leaves the front of its level and is freed
+    void retire(Order* o, Level& l) {
+        lookup.erase(o->id);
+        if (o->group) leavePeg(o, o->group->members.begin(), l);
+        else l.orders.pop_front();
+        unlink(o);
+        delete o;
+    }
 
-    Trades match() {
+    // Sweep the incoming order (on side `aggressor`) through the book.
+    // Self-trade prevention costs one account compare per resting order;
+    // orders it removes are zeroed here and unlinked like filled ones.
+    // Each trade prints at the resting price and goes to the breaker as it
+    // happens, so the sweep stops at its band or at the trade that halts.
+    // With `at` set (an auction uncross) both sides print at that price.
+    Trades match(Side aggressor, Controls* ctl, Price at = 0) {
         Trades trades;
+        StpMode stp = ctl ? ctl->stp : StpMode::Off;
+        RiskBook* risk = ctl ? ctl->risk : nullptr;
         while (!bids.empty() && !asks.empty()) {
-            auto& [bidPx, bidQ] = *bids.begin();
-            auto& [askPx, askQ] = *asks.begin();
-            if (bidPx < askPx) break;
+            auto bidIt = bids.begin();
+            auto askIt = asks.begin();
+            if (bidIt->first < askIt->first) break;
+
+            Level& bl = bidIt->second;
+            Level& al = askIt->second;
+            auto* bid = head(bl);
+            auto* ask = head(al);
+            Price print = at ? at : aggressor == Side::Buy ? ask->px : bid->px;
+            if (ctl && !at && ctl->stops(print)) break;
+            // The incoming order is alone on its level; only the resting side
+            // has a level to publish (an uncross changes both)
+            if (ctl) {
+                if (at || aggressor == Side::Buy) ctl->mark(al, Side::Sell, askIt->first);
+                if (at || aggressor == Side::Sell) ctl->mark(bl, Side::Buy, bidIt->first);
+            }
 
-            auto* bid = bidQ.front();
-            auto* ask = askQ.front();
-            Quantity q = std::min(bid->remaining, ask->remaining);
-            bid->fill(q);
-            ask->fill(q);
+            if (bid->account == ask->account && stp != StpMode::Off && bid->account) {
+                Order* newest = aggressor == Side::Buy ? bid : ask;
+                Order* oldest = aggressor == Side::Buy ? ask : bid;
+                Quantity dq = std::min(bid->remaining, ask->remaining);
+                // A cancel takes an iceberg's reserve with it; a decrement
+                // only the shown part, which then replenishes
+                auto drop = [&](Order* o, Quantity by, bool whole) {
+                    Level& l = o == bid ? bl : al;
+                    Quantity reserve = whole ? o->hidden : 0;
+                    if (whole) by = o->remaining;
+                    if (risk) risk->onRelease(o->account, o->side, by + reserve, by + reserve == o->open());
+                    take(l, o, by);
+                    l.hidden -= reserve;
+                    o->remaining -= by;
+                    o->hidden -= reserve;
+                    if (!o->open()) ctl->stpCancelled.push_back(o->id);
+                };
+                switch (stp) {
+                case StpMode::CancelNewest: drop(newest, 0, true); break;
+                case StpMode::CancelOldest: drop(oldest, 0, true); break;
+                case StpMode::CancelBoth:   drop(newest, 0, true); drop(oldest, 0, true); break;
+                default:                    drop(newest, dq, false); drop(oldest, dq, false); break;
+                }
+            } else {
+                Quantity q = std::min(bid->remaining, ask->remaining);
+                bid->fill(q);
+                ask->fill(q);
+                take(bl, bid, q);
+                take(al, ask, q);
 
-            trades.push_back({ {bid->id,bid->px,q}, {ask->id,ask->px,q} });
+                trades.push_back({ {bid->id,at ? at : bid->px,q}, {ask->id,at ? at : ask->px,q} });
+                if (risk) {
+                    risk->onFill(bid->account, Side::Buy, q, !bid->open());
+                    risk->onFill(ask->account, Side::Sell, q, !ask->open());
+                }
+                if (ctl && !at) ctl->onTrade(print);
+            }
 
-            if (bid->filled()) { lookup.erase(bid->id); bidQ.pop_front(); }
-            if (ask->filled()) { lookup.erase(ask->id); askQ.pop_front(); }
+            if (bid->filled() && !replenish(bid, bl)) retire(bid, bl);
+            if (ask->filled() && !replenish(ask, al)) retire(ask, al);
 
-            if (bidQ.empty()) bids.erase(bidPx);
-            if (askQ.empty()) asks.erase(askPx);
+            if (bl.orders.empty()) bids.erase(bidIt);
+            if (al.orders.empty()) asks.erase(askIt);
         }
         return trades;
     }
+
+    // Auction equilibrium over the crossed range [best ask, best bid] only,
+    // from the call-phase ladder when there is one. Otherwise both level
+    // maps are merged into flat ascending per-price depth arrays and summed
+    // into cumulative buy depth (from the top) and sell depth (from the
+    // bottom). No trial matching either way.
+    AuctionResult equilibrium(Price ref) const {
+        AuctionResult r;
+        if (bids.empty() || asks.empty()) return r;
+        Price lo = asks.begin()->first, hi = bids.begin()->first;
+        if (hi < lo) return r;
+        if (ladder && ladder->dense) return ladder->solve(lo, hi, ref);
+
+        std::vector<std::pair<Price, Quantity>> bl;
+        for (auto it = bids.begin(); it != bids.end() && it->first >= lo; ++it)
+            bl.emplace_back(it->first, it->second.qty + it->second.hidden);
+        std::vector<Price> px;
+        std::vector<int64_t> buy, sell;
+        auto b = bl.rbegin();
+        auto a = asks.begin();
+        while (b != bl.rend() || (a != asks.end() && a->first <= hi)) {
+            bool takeA = a != asks.end() && a->first <= hi;
+            Price p = b == bl.rend() ? a->first : takeA ? std::min(b->first, a->first) : b->first;
+            px.push_back(p);
+            buy.push_back(b != bl.rend() && b->first == p ? (b++)->second : 0);
+            sell.push_back(takeA && a->first == p ? a->second.qty + (a++)->second.hidden : 0);
+        }
+
+        size_t n = px.size();
+        for (size_t k = 1; k < n; ++k) sell[k] += sell[k - 1];
+        for (size_t k = n - 1; k-- > 0;) buy[k] += buy[k + 1];
+        return pickUncross(n, buy.data(), sell.data(), [&](size_t k) { return (int64_t)px[k]; },
+                           [](size_t) { return true; }, ref);
+    }
+};
+
+// -------------------- Compact form --------------------
+// Up to kSmallCap resting orders per side in flat arrays, best price first
+// and FIFO within a price. Holds only books that don't cross: anything that
+// would trade (or overflow a side) promotes the book to the full form.
+struct Orderbook::Small {
+    Order* bids[kSmallCap];
+    Order* asks[kSmallCap];
+    uint8_t nBids = 0, nAsks = 0;
+
+    ~Small() {
+        for (int i = 0; i < nBids; ++i) delete bids[i];
+        for (int i = 0; i < nAsks; ++i) delete asks[i];
+    }
+
+    size_t size() const { return (size_t)nBids + nAsks; }
+
+    // false if the order's side is full
+    bool insert(Order* o) {
+        bool buy = o->side == Side::Buy;
+        Order** arr = buy ? bids : asks;
+        uint8_t& n = buy ? nBids : nAsks;
+        if (n == kSmallCap) return false;
+        int pos = 0;   // after every order at an equal or better price
+        while (pos < n && (buy ? arr[pos]->px >= o->px : arr[pos]->px <= o->px)) ++pos;
+        for (int i = n; i > pos; --i) arr[i] = arr[i - 1];
+        arr[pos] = o;
+        ++n;
+        return true;
+    }
+
+    Order* find(OrderId id) const {
+        for (int i = 0; i < nBids; ++i) if (bids[i]->id == id) return bids[i];
+        for (int i = 0; i < nAsks; ++i) if (asks[i]->id == id) return asks[i];
+        return nullptr;
+    }
+
+    // Unlink (not free) an order; nullptr if the id is unknown
+    Order* remove(OrderId id) {
+        for (int s = 0; s < 2; ++s) {
+            Order** arr = s ? asks : bids;
+            uint8_t& n = s ? nAsks : nBids;
+            for (int i = 0; i < n; ++i) {
+                if (arr[i]->id != id) continue;
+                Order* o = arr[i];
+                for (int j = i + 1; j < n; ++j) arr[j - 1] = arr[j];
+                --n;
+                return o;
+            }
+        }
+        return nullptr;
+    }
+
+    static Levels top(Order* const* arr, int n, size_t maxLevels) {
+        Levels out;
+        for (int i = 0; i < n; ++i) {
+            if (!out.empty() && out.back().price == arr[i]->px) out.back().qty += arr[i]->remaining;
+            else if (out.size() == maxLevels) break;
+            else out.push_back({arr[i]->px, arr[i]->remaining});
+        }
+        return out;
+    }
 };
 
+// -------------------- Form changes --------------------
+// Compact -> full; priority is preserved because the arrays are already in
+// price-time order.
+void Orderbook::promote() {
+    Impl* full = new Impl;
+    if (small_) {
+        for (int i = 0; i < small_->nBids; ++i) full->insert(small_->bids[i]);
+        for (int i = 0; i < small_->nAsks; ++i) full->insert(small_->asks[i]);
+        small_->nBids = small_->nAsks = 0;   // ownership moved
+        delete small_;
+        small_ = nullptr;
+    }
+    pImpl = full;
+}
+
+// After any change to the full form: reprice pegs if the touch moved,
+// release an empty book, demote one that has shrunk back to a few orders.
+void Orderbook::settle() {
+    if (!pImpl || (ctl_ && ctl_->auction)) return;   // a call book may cross
+    if (!pImpl->pegs[0].empty() || !pImpl->pegs[1].empty()) pImpl->repeg(ctl_);
+    size_t n = pImpl->lookup.size();
+    if (n > kDemoteAt || pImpl->pinned()) return;
+    if (n > 0) {
+        Small* s = new Small;
+        for (auto& [px, l] : pImpl->bids) for (auto* o : l.orders) s->bids[s->nBids++] = o;
+        for (auto& [px, l] : pImpl->asks) for (auto* o : l.orders) s->asks[s->nAsks++] = o;
+        pImpl->lookup.clear();                // ownership moved
+        small_ = s;
+    }
+    delete pImpl;
+    pImpl = nullptr;
+}
+
+// A peg's own price is brought up to its group's
+Order* Orderbook::find(OrderId id) const {
+    if (pImpl) {
+        auto it = pImpl->lookup.find(id);
+        if (it == pImpl->lookup.end()) return nullptr;
+        Order* o = it->second.o;
+        if (o->group) o->px = o->group->entry.px;
+        return o;
+    }
+    return small_ ? small_->find(id) : nullptr;
+}
+
+// Remove and free without changing form (callers settle)
+void Orderbook::remove(OrderId id) {
+    if (pImpl) {
+        if (Order* o = pImpl->disarmStop(id)) {   // unseen, so nothing to publish
+            if (ctl_->risk) ctl_->risk->onRelease(o->account, o->side, o->remaining, true);
+            delete o;
+            return;
+        }
+    }
+    if (ctl_) {
+        if (Order* o = find(id)) {
+            if (ctl_->risk) ctl_->risk->onRelease(o->account, o->side, o->open(), true);
+            ctl_->touch(o->side, o->px);
+        }
+    }
+    if (pImpl) { pImpl->cancel(id); return; }
+    if (!small_) return;
+    delete small_->remove(id);
+    if (small_->size() == 0) { delete small_; small_ = nullptr; }
+}
+
+// -------------------- Market data --------------------
+LevelUpdate Orderbook::levelAt(Side s, Price px) const {
+    LevelUpdate u{s, px, 0, 0};
+    if (pImpl) {
+        auto fill = [&](const auto& book) {
+            auto it = book.find(px);
+            if (it != book.end()) {
+                u.qty = it->second.qty;
+                u.orders = it->second.count();
+                u.hidden = it->second.hidden;
+            }
+        };
+        if (s == Side::Buy) fill(pImpl->bids);
+        else fill(pImpl->asks);
+    } else if (small_) {
+        Order* const* arr = s == Side::Buy ? small_->bids : small_->asks;
+        int n = s == Side::Buy ? small_->nBids : small_->nAsks;
+        for (int i = 0; i < n; ++i)
+            if (arr[i]->px == px) { u.qty += arr[i]->remaining; ++u.orders; }
+    }
+    return u;
+}
+
+// One update per level the command changed, with the level's final state
+void Orderbook::publish() {
+    if (!ctl_) return;
+    auto& d = ctl_->dirty;
+    if (!d.empty()) {
+        std::sort(d.begin(), d.end());
+        d.erase(std::unique(d.begin(), d.end()), d.end());
+        auto& ups = ctl_->updates;
+        ups.clear();
+        for (auto& [s, px] : d) ups.push_back(levelAt(s, px));
+        d.clear();
+        ++ctl_->mdEpoch;
+        ctl_->md(ups.data(), ups.size());
+    }
+    if (ctl_->auction && ctl_->indicative) indicate();
+}
+
+// At most once per cadence of book time, and only when the call book moved
+// and the result differs from the last one sent
+void Orderbook::indicate() {
+    AuctionLadder& lad = *pImpl->ladder;
+    if (!lad.changed || ctl_->now < ctl_->nextIndicative) return;
+    lad.changed = false;
+    ctl_->nextIndicative = ctl_->now + ctl_->indicativeEveryNs;
+    AuctionResult r = pImpl->equilibrium(ctl_->lastTrade);
+    AuctionResult& last = ctl_->lastIndicative;
+    if (r.price == last.price && r.volume == last.volume && r.imbalance == last.imbalance) return;
+    last = r;
+    ctl_->indicative(r);
+}
+
 // -------------------- Interface methods --------------------
-Orderbook::Orderbook() : pImpl(new Impl) {}
-Orderbook::~Orderbook() { delete pImpl; }
+Orderbook::Orderbook() = default;
+Orderbook::~Orderbook() { delete pImpl; delete small_; delete ctl_; }
+
+Order* Orderbook::MakeOrder(OrderType t, OrderId id, Side s, Price px, Quantity qty, AccountId account,
+                            uint64_t expireAt) {
+    Order* o = new Order{t,id,s,px,qty,qty,account};
+    if (t == OrderType::GoodTillDate || t == OrderType::GoodTillTime) o->expireAt = expireAt;
+    return o;
+}
+
+Order* Orderbook::MakeIcebergOrder(OrderId id, Side s, Price px, Quantity qty, Quantity peak, AccountId account) {
+    Order* o = MakeOrder(OrderType::GoodTillCancel, id, s, px, qty, account);
+    if (peak && peak < qty) {
+        o->peak = peak;
+        o->remaining = peak;
+        o->hidden = qty - peak;
+    }
+    return o;
+}
+
+Order* Orderbook::MakePeggedOrder(OrderId id, Side s, PegType type, Price offset, Quantity qty, AccountId account) {
+    Order* o = MakeOrder(OrderType::GoodTillCancel, id, s, 0, qty, account);
+    o->pegType = type;
+    o->pegOffset = offset;
+    return o;
+}
 
-Order* Orderbook::MakeOrder(OrderType t, OrderId id, Side s, Price px, Quantity qty) {
-    return new Order{t,id,s,px,qty,qty};
+Order* Orderbook::MakePostOnlyOrder(OrderId id, Side s, Price px, Quantity qty, PostOnly mode, AccountId account) {
+    Order* o = MakeOrder(OrderType::GoodTillCancel, id, s, px, qty, account);
+    o->postOnly = mode;
+    return o;
+}
+
+Order* Orderbook::MakeStopOrder(OrderId id, Side s, Price trigger, Price limit, Quantity qty, AccountId account) {
+    Order* o = new Order{limit ? OrderType::StopLimit : OrderType::Stop, id, s, limit ? limit : trigger, qty, qty,
+                         account};
+    o->stopPx = trigger;
+    return o;
 }
 
 Trades Orderbook::AddOrder(Order* o) {
-    if (pImpl->lookup.count(o->id)) return {};
+    lastReject_ = Reject::None;
+    if (ctl_) ctl_->stpCancelled.clear();
+    if (!admitPostOnly(o, o->px)) { lastReject_ = Reject::WouldTake; delete o; return {}; }
+    if (find(o->id) || (pImpl && pImpl->stopLookup.count(o->id))) {
+        lastReject_ = Reject::DuplicateId;
+        delete o;
+        return {};
+    }
+    bool stop = o->type == OrderType::Stop || o->type == OrderType::StopLimit;
+    if (o->pegType != PegType::None && !(o->px = pegPrice(o))) {
+        lastReject_ = Reject::NoReference;
+        delete o;
+        return {};
+    }
+    if (o->expireAt || stop) controls();   // expiry runs on the book clock, stops on its trades
+    if (ctl_) {
+        lastReject_ = o->expireAt && o->expireAt <= ctl_->now ? Reject::Expired
+                                                              : ctl_->screen(o->px, BestBid(), BestAsk());
+        if (lastReject_ == Reject::None && ctl_->risk)
+            lastReject_ = ctl_->risk->check(o->account, o->side, o->px, o->open());
+        if (lastReject_ != Reject::None) { delete o; return {}; }
+    }
+    Trades trades = stop ? arm(o) : place(o);
+    runStops(trades);
+    publish();
+    return trades;
+}
 
-    Trades trades;
+// Post-only from the opposite best alone (no lookup, no level): false to
+// refuse, else px is left as is or slid to a tick behind that best
+bool Orderbook::admitPostOnly(const Order* o, Price& px) const {
+    if (o->postOnly == PostOnly::Off || InAuction()) return true;
+    bool buy = o->side == Side::Buy;
+    Price opp = buy ? BestAsk() : BestBid();
+    if (!opp || (buy ? px < opp : px > opp)) return true;
+    if (o->postOnly == PostOnly::Reject || (buy && opp == 1)) return false;
+    px = buy ? opp - 1 : opp + 1;
+    return true;
+}
+
+// A waiting stop is open exposure from entry; one whose trigger the last
+// trade has already reached goes straight in
+Trades Orderbook::arm(Order* o) {
+    Price last = ctl_->lastTrade;
+    if (!o->stopPx || (last && (o->side == Side::Buy ? last >= o->stopPx : last <= o->stopPx))) {
+        o->activate(farEnd(o->side == Side::Buy ? Side::Sell : Side::Buy));
+        return place(o);
+    }
+    if (ctl_->risk) ctl_->risk->onAccept(o->account, o->side, o->remaining);
+    if (!pImpl) promote();
+    pImpl->armStop(o);
+    return {};
+}
+
+// Stops reached by the command's trades enter one at a time, in the order
+// they fired. Their own trades widen the range and queue the stops that
+// reaches behind them, so a stop run costs O(stops fired), never a pass
+// over the waiting lists per trade. A refused stop (a market stop with
+// nothing left to hit) is dropped without changing LastReject. Once the
+// breaker halts, nothing more fires: stops taken but not yet entered go
+// back to waiting, still counted as open exposure.
+void Orderbook::runStops(Trades& trades) {
+    if (!ctl_) return;
+    Reject keep = lastReject_;
+    std::vector<Order*> fired;
+    for (size_t i = 0;; ++i) {
+        if (ctl_->halted) {
+            if (i < fired.size() && !pImpl) promote();
+            for (; i < fired.size(); ++i) pImpl->armStop(fired[i]);
+            break;
+        }
+        if (ctl_->runHi && pImpl && !pImpl->stopLookup.empty())
+            pImpl->fireStops(ctl_->runLo, ctl_->runHi, fired);
+        if (i == fired.size()) break;
+        Order* o = fired[i];
+        if (ctl_->risk) ctl_->risk->onRelease(o->account, o->side, o->remaining, true);
+        o->activate(farEnd(o->side == Side::Buy ? Side::Sell : Side::Buy));
+        Trades more = place(o);
+        trades.insert(trades.end(), more.begin(), more.end());
+    }
+    ctl_->runLo = ctl_->runHi = 0;
+    lastReject_ = keep;
+}
+
+// Match and/or rest an order that has passed entry checks
+Trades Orderbook::place(Order* o) {
+    const OrderId id = o->id;          // o is freed by match() if it fills completely
+    const OrderType type = o->type;
+    const Side side = o->side;
+    const Price px = o->px;
+
+    Price opp = side == Side::Buy ? BestAsk() : BestBid();
+    bool marketable = opp && (side == Side::Buy ? px >= opp : px <= opp);
 
-    // select side-specific book
-    if (o->side == Side::Buy) {
-        auto& q = pImpl->bids[o->px];
-        q.push_back(o);
-        auto it = std::prev(q.end());
-        pImpl->lookup.emplace(o->id, std::make_pair(o, it));
-    } else {
-        auto& q = pImpl->asks[o->px];
-        q.push_back(o);
-        auto it = std::prev(q.end());
-        pImpl->lookup.emplace(o->id, std::make_pair(o, it));
+    bool call = ctl_ && ctl_->auction;
+    if (call && type == OrderType::FillAndKill) {
+        lastReject_ = Reject::Auction;
+        delete o;
+        return {};
     }
 
-    // run matcher
-    auto newTrades = pImpl->match();
-    trades.insert(trades.end(), newTrades.begin(), newTrades.end());
+    // FAK that cannot trade: never touches the book
+    if (type == OrderType::FillAndKill && !marketable) {
+        lastReject_ = Reject::NoLiquidity;
+        delete o;
+        return {};
+    }
+    RiskBook* risk = ctl_ ? ctl_->risk : nullptr;
+    if (risk) risk->onAccept(o->account, side, o->open());
+
+    // Resting without trading: stays compact while it fits
+    // Timed orders, icebergs and pegs live in the full form only
+    if (!pImpl) {
+        if (!marketable && !o->expireAt && !o->peak && o->pegType == PegType::None) {
+            if (!small_) small_ = new Small;
+            if (small_->insert(o)) {
+                if (ctl_) ctl_->touch(side, px);
+                return {};
+            }
+        }
+        promote();
+    }
+    if (o->expireAt) {
+        if (!pImpl->wheel) pImpl->wheel = std::make_unique<ExpiryWheel>(ctl_->now);
+        pImpl->wheel->restart(ctl_->now);
+    }
 
-    // handle FAK (FillAndKill)
-    if (o->type == OrderType::FillAndKill && o->remaining > 0) {
-        CancelOrder(o->id);
+    if (ctl_ && !call) ctl_->bound(BestBid(), BestAsk());
+    pImpl->insert(o);
+    Trades trades = call ? Trades{} : pImpl->match(side, ctl_);
+
+    // A sweep cut short by the breaker or its band leaves the order still
+    // crossing. A limit stopped by the band rests at the band's edge when
+    // the next opposite price is beyond it; otherwise (or once halted) the
+    // remainder is cancelled.
+    Price restPx = px;
+    Order* rest = !ctl_ || call || type == OrderType::FillAndKill ? nullptr : find(id);
+    if (rest && !rest->group) {
+        Price now = side == Side::Buy ? BestAsk() : BestBid();
+        if (now && (side == Side::Buy ? px >= now : px <= now)) {
+            Price edge = side == Side::Buy ? ctl_->sweepHi : ctl_->sweepLo;
+            if (!ctl_->halted && edge && (side == Side::Buy ? edge < now : edge > now)) {
+                pImpl->reprice(rest, edge);
+                restPx = edge;
+            } else {
+                if (risk) risk->onRelease(rest->account, side, rest->open(), true);
+                pImpl->cancel(id);
+            }
+        }
     }
+
+    // handle FAK (FillAndKill): cancel whatever is left resting (its level
+    // was never published, so nothing to touch)
+    if (type == OrderType::FillAndKill) {
+        if (risk)
+            if (Order* left = find(id)) risk->onRelease(left->account, side, left->remaining, true);
+        pImpl->cancel(id);
+    }
+
+    if (ctl_ && ctl_->md && pImpl->lookup.count(id)) ctl_->touch(side, restPx);
+
+    settle();
     return trades;
 }
 
 void Orderbook::CancelOrder(OrderId id) {
-    auto it = pImpl->lookup.find(id);
-    if (it == pImpl->lookup.end()) return;
+    remove(id);
+    settle();
+    publish();
+}
+
+// Walks only the account's own orders: O(orders cancelled) in the full
+// form, a scan of at most 2 * kSmallCap in the compact one.
+std::vector<OrderId> Orderbook::cancelAll(AccountId a, bool buys, bool sells) {
+    std::vector<OrderId> ids;
+    if (!a) return ids;
+    if (pImpl) {
+        for (int s = 0; s < 2; ++s)
+            if (s ? sells : buys) pImpl->cancelAccount(a, s, ctl_, ids);
+    } else if (small_) {
+        for (int s = 0; s < 2; ++s) {
+            if (!(s ? sells : buys)) continue;
+            Order* const* arr = s ? small_->asks : small_->bids;
+            int n = s ? small_->nAsks : small_->nBids;
+            for (int i = 0; i < n; ++i)
+                if (arr[i]->account == a) ids.push_back(arr[i]->id);
+        }
+        for (OrderId id : ids) remove(id);
+    }
+    settle();
+    publish();
+    return ids;
+}
+
+std::vector<OrderId> Orderbook::CancelAllForAccount(AccountId a) {
+    return cancelAll(a, true, true);
+}
+
+std::vector<OrderId> Orderbook::CancelAllForAccount(AccountId a, Side s) {
+    return cancelAll(a, s == Side::Buy, s == Side::Sell);
+}
+
+Trades Orderbook::ModifyOrder(OrderId id, Price px, Quantity qty) {
+    lastReject_ = Reject::None;
+    if (ctl_) ctl_->stpCancelled.clear();
+    Order* o = find(id);
+    if (!o || qty == 0) return {};
+    if (px == o->px && qty == o->open()) return {};   // nothing changes, nothing to publish
 
-    auto* o = it->second.first;
-    if (o->side == Side::Buy) {
-        auto mapIt = pImpl->bids.find(o->px);
-        if (mapIt != pImpl->bids.end()) {
-            auto& q = mapIt->second;
-            q.erase(it->second.second);
-            if (q.empty()) pImpl->bids.erase(mapIt);
+    if (px == o->px && qty < o->open()) {
+        Quantity cut = o->open() - qty;
+        Quantity reserve = std::min(cut, o->hidden);   // an iceberg's reserve goes first
+        if (ctl_) {
+            if (ctl_->risk) ctl_->risk->onRelease(o->account, o->side, cut, false);
+            ctl_->touch(o->side, o->px);
         }
-    } else {
-        auto mapIt = pImpl->asks.find(o->px);
-        if (mapIt != pImpl->asks.end()) {
-            auto& q = mapIt->second;
-            q.erase(it->second.second);
-            if (q.empty()) pImpl->asks.erase(mapIt);
+        if (pImpl) {
+            Impl::Level& l = pImpl->levelOf(o);
+            Impl::take(l, o, cut - reserve);
+            l.hidden -= reserve;
+            if (pImpl->ladder) pImpl->ladder->add(o->side, o->px, -(int64_t)cut);
         }
+        o->initial -= cut;
+        o->hidden -= reserve;
+        o->remaining -= cut - reserve;
+        publish();
+        return {};
+    }
+
+    if (o->group) {                    // a peg's price is not its own to change
+        lastReject_ = Reject::PegAmend;
+        return {};
+    }
+    if (!admitPostOnly(o, px)) { lastReject_ = Reject::WouldTake; return {}; }
+
+    // Screen before the original is pulled, so a refused amend leaves it resting
+    if (ctl_) {
+        lastReject_ = ctl_->screen(px, BestBid(), BestAsk());
+        if (lastReject_ == Reject::None && ctl_->risk)
+            lastReject_ = ctl_->risk->check(o->account, o->side, px, qty, o->open(), true);
+        if (lastReject_ != Reject::None) return {};
     }
 
-    pImpl->lookup.erase(it);
-    delete o;
+    OrderType t = o->type;
+    Side s = o->side;
+    AccountId a = o->account;
+    uint64_t expireAt = o->expireAt;
+    Quantity peak = o->peak;
+    PostOnly post = o->postOnly;
+    remove(id);                         // place() settles the form
+    Order* n = peak ? MakeIcebergOrder(id, s, px, qty, peak, a) : MakeOrder(t, id, s, px, qty, a, expireAt);
+    n->postOnly = post;
+    Trades trades = place(n);
+    runStops(trades);
+    publish();
+    return trades;
+}
+
+size_t Orderbook::size() const {
+    if (pImpl) return pImpl->lookup.size();
+    return small_ ? small_->size() : 0;
+}
+
+size_t Orderbook::PendingStops() const { return pImpl ? pImpl->stopLookup.size() : 0; }
+
+Price Orderbook::BestBid() const {
+    if (pImpl) return pImpl->bids.empty() ? 0 : pImpl->bids.begin()->first;
+    return small_ && small_->nBids ? small_->bids[0]->px : 0;
+}
+
+Price Orderbook::BestAsk() const {
+    if (pImpl) return pImpl->asks.empty() ? 0 : pImpl->asks.begin()->first;
+    return small_ && small_->nAsks ? small_->asks[0]->px : 0;
+}
+
+// Where a new peg rests: with its group if there is one, else priced from
+// the touch (0 = nothing to follow)
+Price Orderbook::pegPrice(const Order* o) const {
+    if (!pImpl) return pegAt(o->side, o->pegType, o->pegOffset, BestBid(), BestAsk(), BestBid(), BestAsk());
+    auto& pool = pImpl->pegs[(int)o->side];
+    auto it = pool.find({o->pegType, o->pegOffset});
+    return it != pool.end() ? it->second.entry.px : pImpl->pegPrice(o->side, o->pegType, o->pegOffset);
+}
+
+// Worst resting price on a side (0 when empty): how far a market order may go
+Price Orderbook::farEnd(Side s) const {
+    if (pImpl) {
+        if (s == Side::Buy) return pImpl->bids.empty() ? 0 : pImpl->bids.rbegin()->first;
+        return pImpl->asks.empty() ? 0 : pImpl->asks.rbegin()->first;
+    }
+    if (!small_) return 0;
+    if (s == Side::Buy) return small_->nBids ? small_->bids[small_->nBids - 1]->px : 0;
+    return small_->nAsks ? small_->asks[small_->nAsks - 1]->px : 0;
 }
 
-size_t Orderbook::size() const { return pImpl->lookup.size(); }
+Levels Orderbook::TopBids(size_t n) const {
+    if (pImpl) return Impl::top(pImpl->bids, n);
+    return small_ ? Small::top(small_->bids, small_->nBids, n) : Levels{};
+}
+
+Levels Orderbook::TopAsks(size_t n) const {
+    if (pImpl) return Impl::top(pImpl->asks, n);
+    return small_ ? Small::top(small_->asks, small_->nAsks, n) : Levels{};
+}
+
+void Orderbook::SetControls(const PriceControls& c) {
+    controls();
+    ctl_->cfg = c;
+}
+
+// Allocated on first use, starting from the book clock
+Orderbook::Controls& Orderbook::controls() {
+    if (!ctl_) {
+        ctl_ = new Controls;
+        ctl_->now = now_;
+    }
+    return *ctl_;
+}
+
+void Orderbook::AdvanceTime(uint64_t nowNs) {
+    if (nowNs < now_) return;
+    now_ = nowNs;
+    if (!ctl_) return;
+    ctl_->now = nowNs;
+    if (ctl_->halted && nowNs >= ctl_->haltedUntil) ctl_->halted = false;
+    ctl_->expire();
+    ctl_->expired.clear();
+    if (pImpl && pImpl->wheel) expireDue();
+    publish();   // expiries, and an indicative held back by the cadence
+}
+
+// Everything due comes off in one batch: one settle, one market-data call
+void Orderbook::expireDue() {
+    pImpl->wheel->advance(ctl_->now, ctl_->expired);
+    if (ctl_->expired.empty()) return;
+    for (OrderId id : ctl_->expired) remove(id);
+    settle();
+}
+
+const std::vector<OrderId>& Orderbook::LastExpired() const {
+    static const std::vector<OrderId> none;
+    return ctl_ ? ctl_->expired : none;
+}
+
+void Orderbook::SetRisk(RiskBook* risk) {
+    controls();
+    ctl_->risk = risk;
+}
+
+void Orderbook::SetSelfTradePrevention(StpMode mode) {
+    controls();
+    ctl_->stp = mode;
+}
+
+const std::vector<OrderId>& Orderbook::LastCancelled() const {
+    static const std::vector<OrderId> none;
+    return ctl_ ? ctl_->stpCancelled : none;
+}
+
+void Orderbook::SetMarketDataHandler(LevelUpdateFn fn) {
+    controls();
+    ctl_->md = std::move(fn);
+}
+
+bool Orderbook::Halted() const { return ctl_ && ctl_->halted; }
+
+// -------------------- Call auction --------------------
+void Orderbook::BeginAuction() {
+    controls();
+    if (ctl_->auction) return;
+    ctl_->auction = true;
+    ctl_->lastIndicative = {};
+    ctl_->nextIndicative = 0;
+    if (!pImpl) promote();             // only the full form can hold a crossed book
+    auto& lad = pImpl->ladder = std::make_unique<AuctionLadder>();
+    for (auto& [px, l] : pImpl->bids) lad->add(Side::Buy, px, l.qty + l.hidden);
+    for (auto& [px, l] : pImpl->asks) lad->add(Side::Sell, px, l.qty + l.hidden);
+}
+
+void Orderbook::SetIndicativeHandler(IndicativeFn fn, uint64_t everyNs) {
+    controls();
+    ctl_->indicative = std::move(fn);
+    ctl_->indicativeEveryNs = everyNs;
+}
+
+bool Orderbook::InAuction() const { return ctl_ && ctl_->auction; }
+
+AuctionResult Orderbook::IndicativeUncross() const {
+    return InAuction() ? pImpl->equilibrium(ctl_->lastTrade) : AuctionResult{};
+}
+
+Trades Orderbook::Uncross() {
+    lastReject_ = Reject::None;
+    if (!InAuction()) return {};
+    ctl_->stpCancelled.clear();
+    AuctionResult r = pImpl->equilibrium(ctl_->lastTrade);
+    pImpl->ladder.reset();
+    Trades trades;
+    if (r.volume) {
+        // Greedy best-vs-best matching of a crossed book executes exactly
+        // the equilibrium volume, so one sweep at the auction price does it
+        trades = pImpl->match(Side::Buy, ctl_, r.price);
+        ctl_->onTrade(r.price);
+    }
+    ctl_->auction = false;
+    settle();
+    runStops(trades);                  // stops the uncross price reached
+    publish();
+    return trades;
+}
+
+Orderbook::Form Orderbook::StorageForm() const {
+    return pImpl ? Form::Full : small_ ? Form::Compact : Form::Empty;
+}
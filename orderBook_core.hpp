@@ -1,13 +1,29 @@
 #pragma once
 #include <cstdint>
+#include <cstddef>
+#include <functional>
 #include <vector>
 
-enum class OrderType { GoodTillCancel, FillAndKill };
+// GoodTillDate and GoodTillTime rest until their expiry timestamp (book
+// time, see AdvanceTime); the book treats them alike, GTD being GTT at a
+// session close worked out by the caller. Stop and StopLimit wait off the
+// book until a trade reaches their trigger (MakeStopOrder).
+enum class OrderType { GoodTillCancel, FillAndKill, GoodTillDate, GoodTillTime, Stop, StopLimit };
 enum class Side { Buy, Sell };
 
+// Pegged orders follow the lit touch (best prices of unpegged orders):
+// Primary rests `offset` ticks behind its own side's best, Midpoint that
+// far behind the mid (bids round down, asks up).
+enum class PegType : uint8_t { None, Primary, Midpoint };
+
+// Post-only: an order that would take liquidity on entry is refused, or
+// slid to one tick behind the opposite best, instead of trading
+enum class PostOnly : uint8_t { Off, Reject, Slide };
+
 using Price    = int32_t;
 using Quantity = uint32_t;
 using OrderId  = uint64_t;
+using AccountId = uint32_t;   // 0 = house / unassigned
 
 // Simple trade info struct
 struct TradeInfo {
@@ -24,25 +40,213 @@ struct Trade {
 
 using Trades = std::vector<Trade>;
 
+// Aggregated price level: shown qty summed over its orders, and the
+// iceberg reserve behind it
+struct LevelInfo {
+    Price    price;
+    Quantity qty;
+    Quantity hidden = 0;
+};
+
+using Levels = std::vector<LevelInfo>;
+
+// New state of one price level after a command (qty 0 = level gone)
+struct LevelUpdate {
+    Side     side;
+    Price    price;
+    Quantity qty;
+    uint32_t orders;
+    Quantity hidden = 0;             // iceberg reserve, not shown in qty
+};
+
+// Called once per command that changed the book, one entry per level
+using LevelUpdateFn = std::function<void(const LevelUpdate*, size_t)>;
+
+// Why the last AddOrder/ModifyOrder was refused (None if it was accepted)
+enum class Reject : uint8_t {
+    None, DuplicateId, NoLiquidity, PriceBand, Halted,
+    UnknownAccount, MaxOrderQty, MaxNotional, MaxOpenOrders, MaxPosition,
+    Auction,                         // FAK during a call auction
+    Expired,                         // GTD/GTT whose expiry has already passed
+    NoReference,                     // peg with no touch to follow
+    WouldTake,                       // post-only that would trade on entry
+    PegAmend                         // peg amend that reprices or grows it
+};
+
+// Self-trade prevention: what happens when an order would trade against a
+// resting order of the same (non-zero) account. Newest is the incoming
+// order; Decrement shrinks both by the smaller quantity without a trade.
+enum class StpMode : uint8_t { Off, CancelNewest, CancelOldest, CancelBoth, Decrement };
+
+// Per-book price controls, all O(1) at entry; a zero field disables it.
+// The dynamic band is measured from the last trade (or the touch before
+// any trade). The breaker halts the book when trade prices span more than
+// haltMoveTicks within haltWindowNs; it resumes haltNs later.
+struct PriceControls {
+    Price    staticLo = 0, staticHi = 0;      // fixed limits for the instrument
+    Price    dynamicTicks = 0;                // max distance from the reference price
+    Price    haltMoveTicks = 0;
+    uint64_t haltWindowNs = 1'000'000'000;
+    uint64_t haltNs = 5'000'000'000;
+};
+
+// Call-auction equilibrium (price 0 = nothing crosses). Imbalance is buy
+// minus sell depth at the price; volume is what an uncross would execute.
+struct AuctionResult {
+    Price    price = 0;
+    uint64_t volume = 0;
+    int64_t  imbalance = 0;
+};
+
+// Sent when the indicative uncross of a book in a call phase changes
+using IndicativeFn = std::function<void(const AuctionResult&)>;
+
+class RiskBook;   // orderBook_risk.hpp
+
 // -------------------- Orderbook Interface --------------------
+// Storage follows activity: a book allocates nothing until its first order,
+// holds a few non-crossing orders in a compact inline form, switches to the
+// full price-level form when it would trade or outgrows that, and goes back
+// (or releases everything) as it empties. The API is the same in every form.
 class Orderbook {
 public:
     Orderbook();
     ~Orderbook();
+    Orderbook(const Orderbook&) = delete;
+    Orderbook& operator=(const Orderbook&) = delete;
+
+    // Create a new order object (allocated inside); expireAt is book time
+    // and only applies to GoodTillDate/GoodTillTime
+    struct Order* MakeOrder(OrderType type, OrderId id, Side side, Price px, Quantity qty,
+                            AccountId account = 0, uint64_t expireAt = 0);
+
+    // Stop order: rests unseen until a trade prints at or through trigger
+    // (at or above for a buy, at or below for a sell), then enters as a
+    // GTC limit at `limit`, or with limit 0 as a market order (FAK up to
+    // the far end of the opposite side). A stop the last trade has
+    // already reached enters at once.
+    struct Order* MakeStopOrder(OrderId id, Side side, Price trigger, Price limit, Quantity qty,
+                                AccountId account = 0);
+
+    // Iceberg (GTC): shows `peak` of qty at a time. When a shown peak is
+    // used up the next one comes from the reserve and queues at the back
+    // of its level. A peak of 0 or at least qty makes a plain order.
+    struct Order* MakeIcebergOrder(OrderId id, Side side, Price px, Quantity qty, Quantity peak,
+                                   AccountId account = 0);
+
+    // Pegged GTC, priced from the lit touch and repriced whenever it moves.
+    // Pegs of one side, type and offset form a group that queues as one
+    // entry at its level, so a touch move shifts each group in a single
+    // step and never amends its orders one by one. A group never moves
+    // into the opposite side: it stops a tick short of the best there.
+    struct Order* MakePeggedOrder(OrderId id, Side side, PegType type, Price offset, Quantity qty,
+                                  AccountId account = 0);
 
-    // Create a new order object (allocated inside)
-    struct Order* MakeOrder(OrderType type, OrderId id, Side side, Price px, Quantity qty);
+    // Post-only GTC. Decided from the opposite best price alone, before
+    // any lookup or level work, and again on a repricing amend (outside
+    // call phases, where nothing trades on entry).
+    struct Order* MakePostOnlyOrder(OrderId id, Side side, Price px, Quantity qty,
+                                    PostOnly mode = PostOnly::Reject, AccountId account = 0);
 
-    // Add order to the book (and match if possible)
+    // Add order to the book (and match if possible); the book takes ownership.
+    // The trades include those of any stops the order set off.
     Trades AddOrder(Order* order);
 
-    // Cancel order by id
+    // Cancel order by id (resting, or a stop still waiting)
     void CancelOrder(OrderId id);
 
-    // Number of active orders
+    // Amend a resting order. A pure size-down keeps time priority; anything
+    // else is cancel/replace (same id, back of the new level). For an
+    // iceberg qty counts the reserve too, and a size-down takes from the
+    // reserve first. A peg only takes a size-down at its current price; a
+    // waiting stop takes no amend.
+    Trades ModifyOrder(OrderId id, Price px, Quantity qty);
+
+    // Number of orders resting in the book, and of stops waiting off it
     size_t size() const;
+    size_t PendingStops() const;
+
+    // Top of book (0 when the side is empty)
+    Price BestBid() const;
+    Price BestAsk() const;
+
+    // Best n levels per side, best price first (shown and hidden qty)
+    Levels TopBids(size_t n = 5) const;
+    Levels TopAsks(size_t n = 5) const;
+
+    // Price bands and circuit breaker (off until set). The book has no
+    // clock of its own: AdvanceTime stamps the trades that follow it, ends
+    // a halt once its time is up and expires GTD/GTT orders that are due,
+    // all in one batch; LastExpired lists them.
+    void SetControls(const PriceControls& c);
+    void AdvanceTime(uint64_t nowNs);
+    const std::vector<OrderId>& LastExpired() const;
+    bool Halted() const;
+    Reject LastReject() const { return lastReject_; }
+
+    // Per-account pre-trade checks and counters (not owned; must outlive
+    // the book). nullptr turns them off.
+    void SetRisk(RiskBook* risk);
+
+    // Self-trade prevention (Off by default). Orders it removes are not
+    // trades; LastCancelled lists them for the last AddOrder/ModifyOrder.
+    void SetSelfTradePrevention(StpMode mode);
+    const std::vector<OrderId>& LastCancelled() const;
+
+    // Pull every resting order of one account (optionally one side) and
+    // return their ids. Walks the account's own orders only, so the cost
+    // is O(orders cancelled) however large the book. Account 0 is ignored.
+    std::vector<OrderId> CancelAllForAccount(AccountId account);
+    std::vector<OrderId> CancelAllForAccount(AccountId account, Side side);
+
+    // Level-by-level market data: after each command, one batched call
+    // with the final state of every level it touched
+    void SetMarketDataHandler(LevelUpdateFn fn);
+
+    // Call auction. Between BeginAuction and Uncross orders rest without
+    // matching (FAK is refused) and the book may cross. The uncross price
+    // maximizes executed volume, then minimizes |imbalance|, then is the
+    // one nearest the last trade; everything executes there in one sweep
+    // and the book returns to continuous trading. Self-trade prevention
+    // treats the buy side as the incoming order.
+    void BeginAuction();
+    bool InAuction() const;
+    AuctionResult IndicativeUncross() const;   // what Uncross would do now
+    Trades Uncross();
+
+    // Indicative publication during call phases: after a command (or an
+    // AdvanceTime) that changed the result, at most once per everyNs of
+    // book time. Kept per tick as orders arrive, not recomputed per send.
+    void SetIndicativeHandler(IndicativeFn fn, uint64_t everyNs = 0);
+
+    // Current storage form (diagnostics)
+    enum class Form { Empty, Compact, Full };
+    Form StorageForm() const;
 
 private:
     struct Impl;
-    Impl* pImpl; // opaque pointer to implementation
+    struct Small;
+    struct Controls;
+    Impl*     pImpl  = nullptr;   // full form
+    Small*    small_ = nullptr;   // compact form (at most one of the two is set)
+    Controls* ctl_   = nullptr;   // only for books with controls, hooks or timed orders
+    Reject    lastReject_ = Reject::None;
+    uint64_t  now_ = 0;                // book clock (AdvanceTime)
+
+    Controls& controls();
+    Order* find(OrderId id) const;
+    void remove(OrderId id);
+    void promote();
+    void settle();
+    Trades place(Order* o);
+    Trades arm(Order* o);
+    Price farEnd(Side s) const;
+    Price pegPrice(const Order* o) const;
+    bool admitPostOnly(const Order* o, Price& px) const;
+    void runStops(Trades& trades);
+    std::vector<OrderId> cancelAll(AccountId a, bool buys, bool sells);
+    LevelUpdate levelAt(Side s, Price px) const;
+    void publish();
+    void indicate();
+    void expireDue();
 };
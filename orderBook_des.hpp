@@ -0,0 +1,62 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+// -------------------- Discrete-event simulator --------------------
+// Virtual clock plus a time-ordered event queue. Events at the same
+// timestamp run in scheduling order, so a run is a pure function of its
+// inputs (and seed) and never waits on the wall clock.
+class DiscreteEventSim {
+public:
+    using Action = std::function<void()>;
+
+    uint64_t now() const { return now_; }            // virtual ns
+    size_t pending() const { return heap_.size(); }
+    uint64_t processed() const { return processed_; }
+
+    void at(uint64_t t, Action a) {
+        heap_.push_back({std::max(t, now_), seq_++, std::move(a)});
+        std::push_heap(heap_.begin(), heap_.end(), Later());
+    }
+    void after(uint64_t dt, Action a) { at(now_ + dt, std::move(a)); }
+
+    // Run events with timestamp <= until; the clock then reads `until`
+    // (runUntil(UINT64_MAX) drains the queue and leaves it at the last event)
+    size_t runUntil(uint64_t until) {
+        size_t n = 0;
+        while (!heap_.empty() && heap_.front().t <= until) {
+            std::pop_heap(heap_.begin(), heap_.end(), Later());
+            Event ev = std::move(heap_.back());
+            heap_.pop_back();
+            now_ = ev.t;
+            ev.action();
+            ++n;
+        }
+        processed_ += n;
+        if (until != UINT64_MAX) now_ = std::max(now_, until);
+        return n;
+    }
+
+    // Time of the next event (UINT64_MAX if none)
+    uint64_t nextTime() const { return heap_.empty() ? UINT64_MAX : heap_.front().t; }
+
+private:
+    struct Event {
+        uint64_t t;
+        uint64_t seq;
+        Action   action;
+    };
+    struct Later {
+        bool operator()(const Event& a, const Event& b) const {
+            return a.t != b.t ? a.t > b.t : a.seq > b.seq;
+        }
+    };
+
+    std::vector<Event> heap_;
+    uint64_t now_ = 0;
+    uint64_t seq_ = 0;
+    uint64_t processed_ = 0;
+};
@@ -0,0 +1,55 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+// -------------------- Latency histogram --------------------
+// Log-linear buckets: 16 sub-buckets per power of two (~6% resolution),
+// fixed footprint, so every op can be recorded without growing a vector.
+// Engine-agnostic, so every harness can share it.
+struct LatencyHistogram {
+    static constexpr int SUB_BITS = 4;
+    static constexpr int SUB = 1 << SUB_BITS;
+    static constexpr int BUCKETS = 64 * SUB;
+
+    std::array<uint64_t, BUCKETS> counts{};
+    uint64_t n = 0;
+    uint64_t maxNs = 0;
+    double sumNs = 0;
+
+    static int bucketOf(uint64_t ns) {
+        if (ns < SUB) return (int)ns;
+        int msb = 63 - __builtin_clzll(ns);
+        int sub = (int)((ns >> (msb - SUB_BITS)) & (SUB - 1));
+        return (msb - SUB_BITS + 1) * SUB + sub;
+    }
+    static uint64_t bucketLow(int b) {
+        if (b < SUB) return (uint64_t)b;
+        int msb = b / SUB + SUB_BITS - 1;
+        return ((uint64_t)SUB | (uint64_t)(b % SUB)) << (msb - SUB_BITS);
+    }
+
+    void add(uint64_t ns) {
+        ++counts[bucketOf(ns)];
+        ++n;
+        sumNs += (double)ns;
+        if (ns > maxNs) maxNs = ns;
+    }
+    void merge(const LatencyHistogram& o) {
+        for (int b = 0; b < BUCKETS; ++b) counts[b] += o.counts[b];
+        n += o.n;
+        sumNs += o.sumNs;
+        if (o.maxNs > maxNs) maxNs = o.maxNs;
+    }
+    void reset() { *this = LatencyHistogram{}; }
+
+    uint64_t percentile(double p) const {
+        if (!n) return 0;
+        uint64_t rank = (uint64_t)(p * (double)(n - 1)) + 1, seen = 0;
+        for (int b = 0; b < BUCKETS; ++b) {
+            seen += counts[b];
+            if (seen >= rank) return bucketLow(b);
+        }
+        return maxNs;
+    }
+    double avg() const { return n ? sumNs / (double)n : 0.0; }
+};
@@ -0,0 +1,94 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <utility>
+#include <vector>
+
+// -------------------- Legacy engine --------------------
+// The matcher the interactive simulator embedded before it moved onto
+// orderBook_core: orders held by value in per-level std::lists, no id
+// index (so no cancel/modify), a timestamp stamped on every fill. Kept
+// only so the bench can compare the two engines on the same trace.
+namespace legacy {
+
+enum class Side : uint8_t { Buy, Sell };
+enum class OrderType : uint8_t { GTC, IOC };
+using Price = int32_t;
+using Qty   = uint32_t;
+using Oid   = uint64_t;
+
+struct TradeEvent {
+    Oid bidId{}, askId{};
+    Price px{};
+    Qty qty{};
+    uint64_t ts_ns{};
+    Side aggressor;
+};
+
+class Orderbook {
+public:
+    struct Order { Oid id; Side side; OrderType type; Price px; Qty rem; };
+
+    // ts stamps every fill of this add
+    std::vector<TradeEvent> add(Order o, uint64_t ts) {
+        std::vector<TradeEvent> out;
+
+        auto matchable = [&]() {
+            if (o.side == Side::Buy) return !asks_.empty() && o.px >= asks_.begin()->first;
+            return !bids_.empty() && o.px <= bids_.begin()->first;
+        };
+        auto enqueue = [&]() {
+            if (o.side == Side::Buy) bids_[o.px].push_back(o);
+            else                     asks_[o.px].push_back(o);
+        };
+
+        if (o.type == OrderType::IOC && !matchable()) return out;
+
+        if (o.side == Side::Buy) {
+            while (o.rem && !asks_.empty() && o.px >= asks_.begin()->first) {
+                auto apx = asks_.begin()->first;
+                auto& aq = asks_.begin()->second;
+                auto& top = aq.front();
+                Qty q = std::min(o.rem, top.rem);
+                o.rem -= q; top.rem -= q;
+                out.push_back({o.id, top.id, apx, q, ts, Side::Buy});
+                if (top.rem == 0) { aq.pop_front(); if (aq.empty()) asks_.erase(apx); }
+                if (!o.rem) break;
+            }
+            if (o.rem && o.type == OrderType::GTC) enqueue();
+        } else {
+            while (o.rem && !bids_.empty() && o.px <= bids_.begin()->first) {
+                auto bpx = bids_.begin()->first;
+                auto& bq = bids_.begin()->second;
+                auto& top = bq.front();
+                Qty q = std::min(o.rem, top.rem);
+                o.rem -= q; top.rem -= q;
+                out.push_back({top.id, o.id, bpx, q, ts, Side::Sell});
+                if (top.rem == 0) { bq.pop_front(); if (bq.empty()) bids_.erase(bpx); }
+                if (!o.rem) break;
+            }
+            if (o.rem && o.type == OrderType::GTC) enqueue();
+        }
+        return out;
+    }
+
+    Price bestBid() const { return bids_.empty() ? 0 : bids_.begin()->first; }
+    Price bestAsk() const { return asks_.empty() ? 0 : asks_.begin()->first; }
+
+    size_t restingOrders() const {
+        size_t total = 0;
+        for (auto& p : bids_) total += p.second.size();
+        for (auto& p : asks_) total += p.second.size();
+        return total;
+    }
+
+private:
+    using Q = std::list<Order>;
+    std::map<Price, Q, std::greater<Price>> bids_;
+    std::map<Price, Q, std::less<Price>>    asks_;
+};
+
+} // namespace legacy
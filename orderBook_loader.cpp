@@ -0,0 +1,321 @@
+#include "orderBook_loader.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define OB_HAVE_SSE2 1
+#endif
+
+// -------------------- Binary event format --------------------
+static const char EVENT_MAGIC[8] = {'O','B','E','V','E','N','T','\0'};
+static const uint32_t EVENT_VERSION = 2;   // 1: 16-bit symbol ids, widened on read
+static const size_t SYMBOL_BYTES = 16;
+
+struct EventFileHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t nSymbols;
+    uint64_t count;
+};
+
+// -------------------- MappedFile --------------------
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& path) {
+    file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                        FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) { file_ = nullptr; throw std::runtime_error("cannot open " + path); }
+    LARGE_INTEGER sz;
+    GetFileSizeEx(file_, &sz);
+    size_ = (size_t)sz.QuadPart;
+    if (size_ == 0) return;
+    mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping_) { CloseHandle(file_); throw std::runtime_error("cannot map " + path); }
+    data_ = (const char*)MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+    if (!data_) { CloseHandle(mapping_); CloseHandle(file_); throw std::runtime_error("cannot map " + path); }
+}
+
+MappedFile::~MappedFile() {
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle(mapping_);
+    if (file_) CloseHandle(file_);
+}
+#else
+MappedFile::MappedFile(const std::string& path) {
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) throw std::runtime_error("cannot open " + path);
+    struct stat st;
+    if (fstat(fd_, &st) != 0) { ::close(fd_); throw std::runtime_error("cannot stat " + path); }
+    size_ = (size_t)st.st_size;
+    if (size_ == 0) return;
+    void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (p == MAP_FAILED) { ::close(fd_); throw std::runtime_error("cannot map " + path); }
+    madvise(p, size_, MADV_SEQUENTIAL);
+    data_ = (const char*)p;
+}
+
+MappedFile::~MappedFile() {
+    if (data_) munmap((void*)data_, size_);
+    if (fd_ >= 0) ::close(fd_);
+}
+#endif
+
+// -------------------- Field helpers --------------------
+// Bitmask of ',' and '\n' for 64 bytes at p (bit i <=> p[i])
+static inline uint64_t delimMask64(const char* p) {
+#ifdef OB_HAVE_SSE2
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i nl = _mm_set1_epi8('\n');
+    uint64_t m = 0;
+    for (int k = 0; k < 4; ++k) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + 16 * k));
+        __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, comma), _mm_cmpeq_epi8(v, nl));
+        m |= (uint64_t)(uint32_t)_mm_movemask_epi8(hit) << (16 * k);
+    }
+    return m;
+#else
+    uint64_t m = 0;
+    for (int i = 0; i < 64; ++i)
+        if (p[i] == ',' || p[i] == '\n') m |= 1ULL << i;
+    return m;
+#endif
+}
+
+static inline uint64_t delimMaskTail(const char* p, size_t n) {
+    uint64_t m = 0;
+    for (size_t i = 0; i < n; ++i)
+        if (p[i] == ',' || p[i] == '\n') m |= 1ULL << i;
+    return m;
+}
+
+struct Span { const char* b; const char* e; };
+
+static inline void trim(Span& s) {
+    while (s.b < s.e && (s.e[-1] == '\r' || s.e[-1] == ' ')) --s.e;
+    while (s.b < s.e && *s.b == ' ') ++s.b;
+}
+
+static inline bool parseU64(Span s, uint64_t& out) {
+    if (s.b == s.e) return false;
+    uint64_t v = 0;
+    for (const char* p = s.b; p < s.e; ++p) {
+        unsigned d = (unsigned)(*p - '0');
+        if (d > 9) return false;
+        v = v * 10 + d;
+    }
+    out = v;
+    return true;
+}
+
+static inline bool parseI32(Span s, int32_t& out) {
+    bool neg = (s.b < s.e && *s.b == '-');
+    if (neg) ++s.b;
+    uint64_t v;
+    if (!parseU64(s, v) || v > 0x7FFFFFFFULL) return false;
+    out = neg ? -(int32_t)v : (int32_t)v;
+    return true;
+}
+
+static inline bool parseOp(Span s, uint8_t& op) {
+    if (s.e - s.b != 1) return false;
+    switch (*s.b) {
+    case 'A': op = (uint8_t)TraceOp::Add;    return true;
+    case 'C': op = (uint8_t)TraceOp::Cancel; return true;
+    case 'M': op = (uint8_t)TraceOp::Modify; return true;
+    case 'I': op = (uint8_t)TraceOp::Ioc;    return true;
+    default:  return false;
+    }
+}
+
+// -------------------- EventFileParser --------------------
+EventFileParser::EventFileParser(const std::string& path) : file_(path) {
+    if (file_.size() >= sizeof(EventFileHeader) &&
+        std::memcmp(file_.data(), EVENT_MAGIC, sizeof(EVENT_MAGIC)) == 0) {
+        EventFileHeader h;
+        std::memcpy(&h, file_.data(), sizeof(h));
+        size_t need = sizeof(h) + (size_t)h.nSymbols * SYMBOL_BYTES + (size_t)h.count * sizeof(HistEvent);
+        if ((h.version != EVENT_VERSION && h.version != 1) || file_.size() < need)
+            throw std::runtime_error("bad event file header in " + path);
+        binary_ = true;
+        const char* names = file_.data() + sizeof(h);
+        for (uint32_t i = 0; i < h.nSymbols; ++i) {
+            const char* n = names + i * SYMBOL_BYTES;
+            size_t len = SYMBOL_BYTES;
+            while (len && (n[len - 1] == ' ' || n[len - 1] == '\0')) --len;
+            symbols_.emplace_back(n, len);
+        }
+    }
+}
+
+size_t EventFileParser::parse(const EventBatchFn& emit, size_t batchSize) {
+    return binary_ ? parseBinary(emit, batchSize) : parseCsv(emit, batchSize);
+}
+
+size_t EventFileParser::parseBinary(const EventBatchFn& emit, size_t batchSize) {
+    EventFileHeader h;
+    std::memcpy(&h, file_.data(), sizeof(h));
+    // Records start 8-byte aligned inside the page-aligned mapping: hand them out in place
+    const HistEvent* ev = (const HistEvent*)(file_.data() + sizeof(h) + (size_t)h.nSymbols * SYMBOL_BYTES);
+    std::vector<HistEvent> widened;         // version 1 only: copied out and widened
+    for (uint64_t i = 0; i < h.count; i += batchSize) {
+        size_t n = (size_t)std::min<uint64_t>(batchSize, h.count - i);
+        if (h.version == EVENT_VERSION) { emit(ev + i, n); continue; }
+        widened.assign(ev + i, ev + i + n);
+        for (auto& e : widened) widenSymbols(&e.rec, 1);
+        emit(widened.data(), n);
+    }
+    return (size_t)h.count;
+}
+
+size_t EventFileParser::parseCsv(const EventBatchFn& emit, size_t batchSize) {
+    const char* base = file_.data();
+    const size_t n = file_.size();
+
+    std::unordered_map<std::string_view, uint32_t> symIds;  // views into the mapping
+    std::string_view lastSym;
+    uint32_t lastId = 0;
+
+    std::vector<HistEvent> batch;
+    batch.reserve(batchSize);
+    size_t total = 0;
+    bool firstRow = true;
+
+    Span f[7];
+    int field = 0;
+    const char* fieldStart = base;
+
+    auto endRow = [&](int nFields) {
+        bool header = firstRow;
+        firstRow = false;
+        if (nFields == 1 && f[0].b == f[0].e) return;   // blank line
+        if (nFields != 7) { ++badRows_; return; }
+        for (auto& s : f) trim(s);
+
+        HistEvent ev{};
+        uint64_t id, qty;
+        char side = (f[3].e - f[3].b == 1) ? *f[3].b : '?';
+        if (!parseU64(f[0], ev.ts)) {
+            if (!header) ++badRows_;                     // non-numeric first row = header
+            return;
+        }
+        if (!parseOp(f[2], ev.rec.op) || (side != 'B' && side != 'S') ||
+            !parseU64(f[4], id) || !parseI32(f[5], ev.rec.px) ||
+            !parseU64(f[6], qty) || qty > 0xFFFFFFFFULL || f[1].b == f[1].e) {
+            ++badRows_;
+            return;
+        }
+
+        std::string_view sym(f[1].b, (size_t)(f[1].e - f[1].b));
+        if (sym != lastSym) {
+            auto it = symIds.find(sym);
+            if (it == symIds.end()) {
+                if (symbols_.size() >= 0xFFFFFFFFULL) { ++badRows_; return; }
+                it = symIds.emplace(sym, (uint32_t)symbols_.size()).first;
+                symbols_.emplace_back(sym);
+            }
+            lastSym = sym;
+            lastId = it->second;
+        }
+
+        ev.rec.side = (side == 'B') ? 0 : 1;
+        ev.rec.symbol = lastId;
+        ev.rec.id = id;
+        ev.rec.qty = (uint32_t)qty;
+        batch.push_back(ev);
+        if (batch.size() == batchSize) {
+            emit(batch.data(), batch.size());
+            total += batch.size();
+            batch.clear();
+        }
+    };
+
+    // Walk the structural bitmap 64 bytes at a time; only delimiter
+    // positions are visited, field bodies are touched once by the number parsers.
+    for (size_t blk = 0; blk < n; blk += 64) {
+        uint64_t m = (blk + 64 <= n) ? delimMask64(base + blk) : delimMaskTail(base + blk, n - blk);
+        while (m) {
+            const char* d = base + blk + __builtin_ctzll(m);
+            m &= m - 1;
+            if (field < 7) f[field] = {fieldStart, d};
+            ++field;
+            fieldStart = d + 1;
+            if (*d == '\n') { endRow(field); field = 0; }
+        }
+    }
+    if (fieldStart < base + n) {            // last row without trailing newline
+        if (field < 7) f[field] = {fieldStart, base + n};
+        endRow(field + 1);
+    }
+
+    if (!batch.empty()) {
+        emit(batch.data(), batch.size());
+        total += batch.size();
+    }
+    return total;
+}
+
+void writeEventFile(const std::string& path, const std::vector<std::string>& symbols,
+                    const std::vector<HistEvent>& events) {
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) throw std::runtime_error("cannot open " + path);
+
+    EventFileHeader h{};
+    std::memcpy(h.magic, EVENT_MAGIC, sizeof(h.magic));
+    h.version = EVENT_VERSION;
+    h.nSymbols = (uint32_t)symbols.size();
+    h.count = events.size();
+    std::fwrite(&h, sizeof(h), 1, f);
+
+    for (auto& s : symbols) {
+        if (s.size() > SYMBOL_BYTES) { std::fclose(f); throw std::runtime_error("symbol too long: " + s); }
+        char name[SYMBOL_BYTES];
+        std::memset(name, ' ', sizeof(name));
+        std::memcpy(name, s.data(), s.size());
+        std::fwrite(name, sizeof(name), 1, f);
+    }
+    if (!events.empty()) std::fwrite(events.data(), sizeof(HistEvent), events.size(), f);
+    std::fclose(f);
+}
+
+// -------------------- BacktestFeed --------------------
+BacktestFeed::BacktestFeed(const std::string& path, size_t ringCapacity)
+    : parser_(path), ring_(ringCapacity) {
+    worker_ = std::thread([this] {
+        parser_.parse([this](const HistEvent* ev, size_t n) {
+            while (n && !stop_.load(std::memory_order_relaxed)) {
+                size_t k = ring_.tryPush(ev, n);
+                ev += k;
+                n -= k;
+                if (!k) std::this_thread::yield();     // matcher is behind
+            }
+        });
+        done_.store(true, std::memory_order_release);
+    });
+}
+
+BacktestFeed::~BacktestFeed() {
+    stop_.store(true, std::memory_order_relaxed);   // consumer may have stopped early
+    if (worker_.joinable()) worker_.join();
+}
+
+size_t BacktestFeed::next(HistEvent* out, size_t max) {
+    for (;;) {
+        size_t k = ring_.tryPop(out, max);
+        if (k) return k;
+        if (done_.load(std::memory_order_acquire)) return ring_.tryPop(out, max);
+        ++waits_;
+        std::this_thread::yield();
+    }
+}
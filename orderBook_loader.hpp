@@ -0,0 +1,101 @@
+#pragma once
+#include "orderBook_trace.hpp"
+#include "orderBook_ring.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// -------------------- Historical order events --------------------
+// One inbound op with its exchange timestamp. The op itself reuses the
+// trace record layout; rec.symbol indexes the file's symbol table.
+struct HistEvent {
+    uint64_t    ts;
+    TraceRecord rec;
+};
+static_assert(sizeof(HistEvent) == 32, "event layout");
+
+// Input formats:
+//  CSV    ts,symbol,op,side,id,px,qty   op = A|C|M|I, side = B|S, px in ticks;
+//         a header row is skipped if its first field is not numeric
+//  Binary "OBEVENT" header, fixed 16-byte symbol names, then HistEvent[]
+//         (written by writeEventFile; loads with no parsing at all)
+// Symbol ids are 32-bit, so a file may name up to 2^32 - 1 symbols.
+
+// -------------------- Memory-mapped input --------------------
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);   // throws on failure
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+// -------------------- Parser --------------------
+using EventBatchFn = std::function<void(const HistEvent*, size_t)>;
+
+class EventFileParser {
+public:
+    explicit EventFileParser(const std::string& path);
+
+    // Parse the whole file, delivering events in batches of up to batchSize.
+    // Returns the number of events; malformed CSV rows are counted and skipped.
+    size_t parse(const EventBatchFn& emit, size_t batchSize = 1024);
+
+    const std::vector<std::string>& symbols() const { return symbols_; }
+    bool binary() const { return binary_; }
+    size_t badRows() const { return badRows_; }
+
+private:
+    size_t parseCsv(const EventBatchFn& emit, size_t batchSize);
+    size_t parseBinary(const EventBatchFn& emit, size_t batchSize);
+
+    MappedFile file_;
+    bool binary_ = false;
+    size_t badRows_ = 0;
+    std::vector<std::string> symbols_;
+};
+
+// Write events (symbols indexed by rec.symbol) in the binary event format
+void writeEventFile(const std::string& path, const std::vector<std::string>& symbols,
+                    const std::vector<HistEvent>& events);
+
+// -------------------- Background feed --------------------
+// Parses on its own thread and hands events to the matcher through an SPSC
+// ring, so the consumer only ever pays for a ring pop.
+class BacktestFeed {
+public:
+    explicit BacktestFeed(const std::string& path, size_t ringCapacity = 1 << 16);
+    ~BacktestFeed();
+
+    // Blocks until events are available; returns 0 once the file is drained
+    size_t next(HistEvent* out, size_t max);
+
+    // Symbol table is complete once next() has returned 0
+    const std::vector<std::string>& symbols() const { return parser_.symbols(); }
+    size_t badRows() const { return parser_.badRows(); }
+    uint64_t consumerWaits() const { return waits_; }   // polls that found the ring empty
+
+private:
+    EventFileParser parser_;
+    SpscRing<HistEvent> ring_;
+    std::atomic<bool> done_{false};
+    std::atomic<bool> stop_{false};
+    uint64_t waits_ = 0;
+    std::thread worker_;
+};
@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// -------------------- Single-producer / single-consumer ring --------------------
+// Bounded, lock-free, power-of-two capacity. Batch push/pop amortize the
+// atomic traffic; each side caches the other's index to avoid touching the
+// shared cache line on every call.
+template <class T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity = 1 << 16) {
+        size_t cap = 1;
+        while (cap < capacity) cap <<= 1;
+        buf_.resize(cap);
+        mask_ = cap - 1;
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // Producer: push up to n items, returns how many were accepted
+    size_t tryPush(const T* items, size_t n) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t room = capacity() - (tail - headCache_);
+        if (room < n) {
+            headCache_ = head_.load(std::memory_order_acquire);
+            room = capacity() - (tail - headCache_);
+        }
+        if (n > room) n = room;
+        for (size_t i = 0; i < n; ++i) buf_[(tail + i) & mask_] = items[i];
+        tail_.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    bool tryPush(const T& item) { return tryPush(&item, 1) == 1; }
+
+    // Consumer: pop up to max items into out, returns how many were taken
+    size_t tryPop(T* out, size_t max) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t avail = tailCache_ - head;
+        if (avail == 0) {
+            tailCache_ = tail_.load(std::memory_order_acquire);
+            avail = tailCache_ - head;
+        }
+        if (max > avail) max = avail;
+        for (size_t i = 0; i < max; ++i) out[i] = buf_[(head + i) & mask_];
+        head_.store(head + max, std::memory_order_release);
+        return max;
+    }
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    std::vector<T> buf_;
+    size_t mask_ = 0;
+
+    alignas(64) std::atomic<size_t> head_{0};   // consumer-owned
+    size_t tailCache_ = 0;
+    alignas(64) std::atomic<size_t> tail_{0};   // producer-owned
+    size_t headCache_ = 0;
+};
@@ -0,0 +1,81 @@
+#pragma once
+#include "orderBook_core.hpp"
+#include <cstdint>
+#include <vector>
+
+// -------------------- Pre-trade risk --------------------
+// Per-account limits and running counters in one dense array indexed by
+// account id, so a check is a bounds test plus a few compares and every
+// update is a handful of adds. A book calls it on entry, fill and release
+// (SetRisk); one RiskBook per instrument, since positions are per
+// instrument. It is not locked: share it only between books driven from
+// the same thread. Account 0 is the house account and is never checked.
+struct RiskLimits {                  // 0 = no limit
+    Quantity maxOrderQty   = 0;
+    int64_t  maxNotional   = 0;      // price * qty of one order, in ticks
+    uint32_t maxOpenOrders = 0;
+    int64_t  maxPosition   = 0;      // |position| if every open order on that side filled
+};
+
+struct AccountState {
+    RiskLimits limits;
+    int64_t  position = 0;           // filled buys - filled sells
+    int64_t  openBuy = 0, openSell = 0;
+    uint32_t openOrders = 0;
+};
+
+class RiskBook {
+public:
+    explicit RiskBook(size_t nAccounts = 0, const RiskLimits& defaults = {})
+        : accounts_(nAccounts + 1) {
+        for (auto& a : accounts_) a.limits = defaults;
+    }
+
+    size_t size() const { return accounts_.size() - 1; }
+    void setLimits(AccountId a, const RiskLimits& l) { accounts_.at(a).limits = l; }
+    const AccountState& account(AccountId a) const { return accounts_.at(a); }
+
+    // Would this order pass? `freed` describes an order it replaces (an
+    // amend), whose exposure is released first.
+    Reject check(AccountId id, Side s, Price px, Quantity qty, Quantity freed = 0, bool replaces = false) const {
+        if (id == 0) return Reject::None;
+        if (id >= accounts_.size()) return Reject::UnknownAccount;
+        const AccountState& a = accounts_[id];
+        const RiskLimits& l = a.limits;
+        if (l.maxOrderQty && qty > l.maxOrderQty) return Reject::MaxOrderQty;
+        if (l.maxNotional && (int64_t)px * qty > l.maxNotional) return Reject::MaxNotional;
+        if (l.maxOpenOrders && a.openOrders - replaces >= l.maxOpenOrders) return Reject::MaxOpenOrders;
+        if (l.maxPosition) {
+            int64_t worst = s == Side::Buy ? a.position + a.openBuy - freed + qty
+                                           : a.openSell - freed + qty - a.position;
+            if (worst > l.maxPosition) return Reject::MaxPosition;
+        }
+        return Reject::None;
+    }
+
+    void onAccept(AccountId id, Side s, Quantity qty) {
+        if (id == 0 || id >= accounts_.size()) return;
+        AccountState& a = accounts_[id];
+        ++a.openOrders;
+        (s == Side::Buy ? a.openBuy : a.openSell) += qty;
+    }
+
+    void onFill(AccountId id, Side s, Quantity qty, bool done) {
+        if (id == 0 || id >= accounts_.size()) return;
+        AccountState& a = accounts_[id];
+        if (s == Side::Buy) { a.position += qty; a.openBuy -= qty; }
+        else                { a.position -= qty; a.openSell -= qty; }
+        a.openOrders -= done;
+    }
+
+    // Cancelled, killed or reduced: `qty` leaves the open exposure
+    void onRelease(AccountId id, Side s, Quantity qty, bool done) {
+        if (id == 0 || id >= accounts_.size()) return;
+        AccountState& a = accounts_[id];
+        (s == Side::Buy ? a.openBuy : a.openSell) -= qty;
+        a.openOrders -= done;
+    }
+
+private:
+    std::vector<AccountState> accounts_;   // [0] is the unchecked house account
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+
+// -------------------- xoshiro256** PRNG --------------------
+// Small, fast, seedable; state is expanded from a 64-bit seed via splitmix64.
+class Xoshiro256 {
+public:
+    explicit Xoshiro256(uint64_t seed = 1) {
+        for (auto& w : s) {
+            seed += 0x9E3779B97F4A7C15ULL;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            w = z ^ (z >> 31);
+        }
+    }
+
+    uint64_t next() {
+        uint64_t result = rotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0]; s[3] ^= s[1]; s[1] ^= s[2]; s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    // Uniform in [0, n) (multiply-shift, no modulo)
+    uint64_t below(uint64_t n) {
+        return (uint64_t)(((unsigned __int128)next() * n) >> 64);
+    }
+
+    // Uniform in [0, 1)
+    double uniform() { return (next() >> 11) * 0x1.0p-53; }
+
+    // Exponential inter-arrival with the given mean
+    double exponential(double mean) { return -std::log(1.0 - uniform()) * mean; }
+
+private:
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+    uint64_t s[4];
+};
@@ -1,32 +1,38 @@
 #include "orderBook_core.hpp"
+#include "orderBook_workload.hpp"
+#include "orderBook_histogram.hpp"
 #include <chrono>
 #include <thread>
 #include <iostream>
 #include <vector>
-#include <random>
 #include <iomanip>
 #include <atomic>
 #include <fstream>
 #include <mutex>
 #include <algorithm>
+#include <numeric>
 #include <windows.h>
 #include <psapi.h>
 
 using namespace std;
 
-// ---------- Simple RNG ----------
-static inline int randBetween(int min, int max) {
-    static thread_local std::mt19937_64 rng(std::random_device{}());
-    std::uniform_int_distribution<int> dist(min, max);
-    return dist(rng);
+// Components of one stress op, recorded separately so contention changes
+// (lock wait) can be told apart from engine changes (service time).
+enum Component { AllocTime, LockWait, AddService, CancelService, ModifyService, NUM_COMPONENTS };
+static const char* componentName(int c) {
+    static const char* names[NUM_COMPONENTS] = {"alloc", "lock_wait", "add_service",
+                                                "cancel_service", "modify_service"};
+    return names[c];
 }
 
 // ---------- Latency stats ----------
 struct LatencyStats {
-    vector<double> samples; // ns per op
+    vector<double> samples; // end-to-end ns per op
+    LatencyHistogram hist[NUM_COMPONENTS];
     uint64_t tradeCount = 0;
     void add(double ns) { samples.push_back(ns); }
     void addTrades(size_t n) { tradeCount += n; }
+    void record(Component c, uint64_t ns) { hist[c].add(ns); }
 
     void summarize(int threadId) {
         if (samples.empty()) return;
@@ -39,44 +45,67 @@ struct LatencyStats {
              << " | ops=" << samples.size()
              << " trades=" << tradeCount
              << " avg=" << avg << "ns p50=" << p50 << "ns p99=" << p99 << "ns\n";
+        for (int c = 0; c < NUM_COMPONENTS; ++c) {
+            const auto& h = hist[c];
+            if (!h.n) continue;
+            cout << "    " << left << setw(15) << componentName(c) << right
+                 << " n=" << h.n
+                 << " avg=" << h.avg() << "ns p50=" << h.percentile(0.50)
+                 << "ns p99=" << h.percentile(0.99) << "ns max=" << h.maxNs << "ns\n";
+        }
     }
 };
 
+static inline uint64_t elapsedNs(chrono::high_resolution_clock::time_point a,
+                                 chrono::high_resolution_clock::time_point b) {
+    return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(b - a).count();
+}
+
 // ---------- Stress Worker ----------
-void stressWorker(Orderbook& ob, size_t nOps, atomic<uint64_t>& tradeCount,
-                  int threadId, vector<LatencyStats>& allStats, mutex& obLock)
+void stressWorker(Orderbook& ob, const vector<WorkloadOp>& ops, atomic<uint64_t>& tradeCount,
+                  int threadId, vector<LatencyStats>& allStats, mutex& obLock,
+                  vector<TraceRecord>* recorded)
 {
     cout << "[Thread " << threadId << "] started\n" << flush;
 
     LatencyStats stats;
     try {
-        for (size_t i = 0; i < nOps; ++i) {
-            auto t1 = chrono::high_resolution_clock::now();
-
-            Side s = (randBetween(0, 1) ? Side::Buy : Side::Sell);
-            Price px = (s == Side::Buy ? 100 + randBetween(0, 20)
-                                       : 101 + randBetween(0, 20));
-            Quantity qty = randBetween(1, 50);
-
-            auto* o = ob.MakeOrder(OrderType::GoodTillCancel,
-                                   (threadId * 10'000'000ULL) + i, s, px, qty);
+        for (size_t i = 0; i < ops.size(); ++i) {
+            const WorkloadOp& op = ops[i];
+            auto t0 = chrono::high_resolution_clock::now();
+
+            // allocation happens outside the lock
+            Order* o = nullptr;
+            auto tAlloc = t0;
+            if (op.type == OpType::Add || op.type == OpType::Ioc)
+                o = ob.MakeOrder(op.type == OpType::Add ? OrderType::GoodTillCancel
+                                                        : OrderType::FillAndKill,
+                                 op.id, op.side, op.px, op.qty);
+            auto tLockReq = chrono::high_resolution_clock::now();
 
             // protect shared Orderbook (non-thread-safe)
+            chrono::high_resolution_clock::time_point tLocked, tDone;
             {
                 lock_guard<mutex> lock(obLock);
-                auto trades = ob.AddOrder(o);
-                stats.addTrades(trades.size());
-                tradeCount += trades.size();
-
-                // occasional cancels
-                if (i % 1000 == 0 && ob.size() > 0) {
-                    auto cancelId = (threadId * 10'000'000ULL) + randBetween(0, (int)i);
-                    ob.CancelOrder(cancelId);
-                }
+                tLocked = chrono::high_resolution_clock::now();
+                if (recorded) recorded->push_back(toTrace(op)); // exact arrival order at the book
+                size_t nTrades = 0;
+                if (o) nTrades = ob.AddOrder(o).size();
+                else if (op.type == OpType::Modify) nTrades = ob.ModifyOrder(op.id, op.px, op.qty).size();
+                else ob.CancelOrder(op.id);
+                tDone = chrono::high_resolution_clock::now();
+                stats.addTrades(nTrades);
+                tradeCount += nTrades;
             }
 
+            if (o) stats.record(AllocTime, elapsedNs(tAlloc, tLockReq));
+            stats.record(LockWait, elapsedNs(tLockReq, tLocked));
+            stats.record(o ? AddService
+                           : op.type == OpType::Modify ? ModifyService : CancelService,
+                         elapsedNs(tLocked, tDone));
+
             auto t2 = chrono::high_resolution_clock::now();
-            double ns = chrono::duration<double, nano>(t2 - t1).count();
+            double ns = chrono::duration<double, nano>(t2 - t0).count();
             stats.add(ns);
 
             if (threadId == 0 && i % 200000 == 0) cout << "." << flush;
@@ -98,6 +127,23 @@ void exportCSV(const vector<LatencyStats>& allStats, const string& filename) {
     out.close();
     cout << "\nSaved latency samples to " << filename << endl;
 }
+
+// Per-thread, per-component histogram buckets (non-empty buckets only)
+void exportBreakdownCSV(const vector<LatencyStats>& allStats, const string& filename) {
+    ofstream out(filename);
+    out << "thread_id,component,bucket_ns,count\n";
+    for (size_t t = 0; t < allStats.size(); ++t) {
+        for (int c = 0; c < NUM_COMPONENTS; ++c) {
+            const auto& h = allStats[t].hist[c];
+            for (int b = 0; b < LatencyHistogram::BUCKETS; ++b)
+                if (h.counts[b])
+                    out << t << "," << componentName(c) << "," << LatencyHistogram::bucketLow(b)
+                        << "," << h.counts[b] << "\n";
+        }
+    }
+    out.close();
+    cout << "Saved latency breakdown to " << filename << endl;
+}
 // ---------- System Resource Logger ----------
 struct ResourceSample {
     double timestamp; // seconds
@@ -127,7 +173,8 @@ ResourceSample getResourceUsage(double startTimeSec) {
 }
 
 // ---------- Stress Test ----------
-void runStressTest(size_t totalOps = 5'000'000, int nThreads = 4, bool dumpCSV = true) {
+void runStressTest(size_t totalOps = 5'000'000, int nThreads = 4, bool dumpCSV = true,
+                   uint64_t seed = 1, const string& recordPath = "") {
     cout << "\n=== STRESS TEST START ===" << endl;
     Orderbook ob;
     atomic<uint64_t> tradeCount{0};
@@ -136,6 +183,20 @@ void runStressTest(size_t totalOps = 5'000'000, int nThreads = 4, bool dumpCSV =
     size_t opsPerThread = totalOps / nThreads;
     vector<LatencyStats> allStats(nThreads);
 
+    // Pre-generate each thread's flow (seeded per thread, disjoint id ranges)
+    vector<vector<WorkloadOp>> flows(nThreads);
+    for (int t = 0; t < nThreads; ++t) {
+        WorkloadConfig cfg;
+        cfg.seed = seed + t;
+        cfg.firstId = t * 10'000'000ULL;
+        flows[t] = WorkloadGenerator(cfg).generate(opsPerThread);
+    }
+
+    // Optional capture of the interleaved stream, appended under obLock
+    vector<TraceRecord> recorded;
+    if (!recordPath.empty()) recorded.reserve(opsPerThread * nThreads);
+    vector<TraceRecord>* rec = recordPath.empty() ? nullptr : &recorded;
+
     auto start = chrono::high_resolution_clock::now();
     double startTimeSec = chrono::duration<double>(start.time_since_epoch()).count();
 
@@ -153,8 +214,8 @@ void runStressTest(size_t totalOps = 5'000'000, int nThreads = 4, bool dumpCSV =
     // ---------- Launch worker threads ----------
     vector<thread> workers;
     for (int t = 0; t < nThreads; ++t)
-        workers.emplace_back(stressWorker, ref(ob), opsPerThread, ref(tradeCount),
-                             t, ref(allStats), ref(obLock));
+        workers.emplace_back(stressWorker, ref(ob), cref(flows[t]), ref(tradeCount),
+                             t, ref(allStats), ref(obLock), rec);
 
     for (auto& th : workers)
         if (th.joinable()) th.join();
@@ -183,7 +244,16 @@ void runStressTest(size_t totalOps = 5'000'000, int nThreads = 4, bool dumpCSV =
     cout << "Throughput     : " << (totalOps / secs) << " ops/sec\n";
     cout << "=======================" << endl;
 
-    if (dumpCSV) exportCSV(allStats, "latency_samples.csv");
+    if (dumpCSV) {
+        exportCSV(allStats, "latency_samples.csv");
+        exportBreakdownCSV(allStats, "latency_breakdown.csv");
+    }
+
+    if (rec) {
+        TraceWriter w(recordPath);
+        w.write(recorded);
+        cout << "Recorded " << w.count() << " ops to " << recordPath << "\n";
+    }
 
     // ---------- Export system resource usage ----------
     ofstream sysOut("system_usage.csv");
@@ -195,11 +265,20 @@ void runStressTest(size_t totalOps = 5'000'000, int nThreads = 4, bool dumpCSV =
 }
 
 // ---------- Main ----------
-int main() {
+// Usage: orderBook_stress [--seed <n>] [--record <trace>]
+int main(int argc, char** argv) {
     try {
         std::cout.setf(std::ios::unitbuf);  // auto-flush every << output
 
-        runStressTest(5'000'000, 4, true); // 5M ops, 4 threads, export CSV
+        uint64_t seed = 1;
+        string recordPath;
+        for (int i = 1; i + 1 < argc; ++i) {
+            string arg = argv[i];
+            if (arg == "--seed") seed = stoull(argv[++i]);
+            else if (arg == "--record") recordPath = argv[++i];
+        }
+
+        runStressTest(5'000'000, 4, true, seed, recordPath); // 5M ops, 4 threads, export CSV
     } catch (const std::exception& e) {
         std::cerr << "\n[MAIN THREAD] Exception: " << e.what() << std::endl;
     } catch (...) {
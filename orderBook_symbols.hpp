@@ -0,0 +1,150 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// -------------------- Instrument reference data --------------------
+// External prices are fixed-point integers with `scale` decimals (189.25
+// at scale 2 is 18925). Engines only ever see tick indices inside the
+// instrument's band, 1 at minPx up to levels() at maxPx, so a per-instrument
+// ladder can index a level with a single subtract. Every division happens
+// here, at the edge; 0 stays free to mean "no price".
+struct InstrumentSpec {
+    uint8_t scale = 0;            // decimals of external prices
+    int64_t tick  = 1;            // tick size, external units
+    int64_t minPx = 1;            // band, external units, inclusive
+    int64_t maxPx = INT32_MAX;
+
+    int32_t levels() const { return (int32_t)((maxPx - minPx) / tick + 1); }
+
+    // false if the price is off the tick grid or outside the band
+    bool toTicks(int64_t px, int32_t& ticks) const {
+        if (px < minPx || px > maxPx || (px - minPx) % tick) return false;
+        ticks = (int32_t)((px - minPx) / tick + 1);
+        return true;
+    }
+    int64_t fromTicks(int32_t ticks) const { return minPx + (int64_t)(ticks - 1) * tick; }
+
+    std::string format(int32_t ticks) const { return formatFixed(fromTicks(ticks), scale); }
+
+    // "189.25" -> 18925 at scale 2; false on malformed input or excess decimals
+    static bool parseFixed(std::string_view s, uint8_t scale, int64_t& out) {
+        bool neg = !s.empty() && s[0] == '-';
+        if (neg) s.remove_prefix(1);
+        int64_t v = 0;
+        int decimals = -1, digits = 0;
+        for (char c : s) {
+            if (c == '.' && decimals < 0) { decimals = 0; continue; }
+            if (c < '0' || c > '9' || v > INT64_MAX / 100) return false;
+            v = v * 10 + (c - '0');
+            ++digits;
+            if (decimals >= 0 && ++decimals > scale) return false;
+        }
+        if (!digits) return false;
+        for (int d = decimals < 0 ? 0 : decimals; d < scale; ++d) v *= 10;
+        out = neg ? -v : v;
+        return true;
+    }
+    static uint8_t decimalsOf(std::string_view s) {
+        auto dot = s.find('.');
+        return dot == std::string_view::npos ? 0 : (uint8_t)(s.size() - dot - 1);
+    }
+    static std::string formatFixed(int64_t v, uint8_t scale) {
+        std::string digits = std::to_string(v < 0 ? -v : v);
+        if (scale) {
+            if (digits.size() <= scale) digits.insert(0, scale + 1 - digits.size(), '0');
+            digits.insert(digits.size() - scale, ".");
+        }
+        return v < 0 ? "-" + digits : digits;
+    }
+};
+
+// -------------------- Symbol registry --------------------
+// Interns symbol names to dense ids 0..size()-1 at load time, so hot paths
+// index contiguous per-symbol arrays by id and only the edges (reference
+// data, config, user input, output) deal in strings.
+using SymbolId = uint32_t;
+constexpr SymbolId kNoSymbol = UINT32_MAX;
+
+class SymbolRegistry {
+public:
+    SymbolRegistry() = default;
+    SymbolRegistry(std::initializer_list<const char*> names) {
+        for (const char* n : names) intern(n);
+    }
+
+    // Existing id, or the next dense id for a new name
+    SymbolId intern(const std::string& name, const InstrumentSpec& spec = {}) {
+        auto it = ids_.find(name);
+        if (it != ids_.end()) return it->second;
+        SymbolId id = (SymbolId)names_.size();
+        ids_.emplace(name, id);
+        names_.push_back(name);
+        specs_.push_back(spec);
+        return id;
+    }
+
+    SymbolId find(const std::string& name) const {
+        auto it = ids_.find(name);
+        return it == ids_.end() ? kNoSymbol : it->second;
+    }
+
+    const std::string& name(SymbolId id) const { return names_[id]; }
+    const std::vector<std::string>& names() const { return names_; }
+    const InstrumentSpec& spec(SymbolId id) const { return specs_[id]; }
+    size_t size() const { return names_.size(); }
+
+    void reserve(size_t n) {
+        names_.reserve(n);
+        specs_.reserve(n);
+        ids_.reserve(n);
+    }
+
+private:
+    std::vector<std::string> names_;
+    std::vector<InstrumentSpec> specs_;
+    std::unordered_map<std::string, SymbolId> ids_;
+};
+
+// Reference data, one instrument per line: SYMBOL [TICK MIN MAX], prices as
+// decimals ("BTCUSD 0.5 60000 80000"); the scale is the most decimals used.
+// Without them the instrument trades raw integer ticks. '#' starts a
+// comment. Throws std::runtime_error on an unreadable file, a malformed
+// line or a duplicate symbol.
+inline SymbolRegistry loadSymbolFile(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("cannot open symbol file " + path);
+    SymbolRegistry reg;
+    std::string line, name, tick, lo, hi;
+    for (size_t lineNo = 1; std::getline(in, line); ++lineNo) {
+        std::istringstream ss(line.substr(0, line.find('#')));
+        if (!(ss >> name)) continue;
+        auto fail = [&](const std::string& why) {
+            return std::runtime_error(path + ":" + std::to_string(lineNo) + ": " + why);
+        };
+        if (reg.find(name) != kNoSymbol) throw fail("duplicate symbol " + name);
+
+        InstrumentSpec spec;
+        if (ss >> tick) {
+            if (!(ss >> lo >> hi)) throw fail("expected SYMBOL TICK MIN MAX");
+            spec.scale = std::max({InstrumentSpec::decimalsOf(tick), InstrumentSpec::decimalsOf(lo),
+                                   InstrumentSpec::decimalsOf(hi)});
+            if (spec.scale > 9 ||
+                !InstrumentSpec::parseFixed(tick, spec.scale, spec.tick) ||
+                !InstrumentSpec::parseFixed(lo, spec.scale, spec.minPx) ||
+                !InstrumentSpec::parseFixed(hi, spec.scale, spec.maxPx))
+                throw fail("bad price field");
+            if (spec.tick <= 0 || spec.minPx > spec.maxPx ||
+                (spec.maxPx - spec.minPx) / spec.tick >= INT32_MAX)
+                throw fail("bad tick size or band");
+        }
+        reg.intern(name, spec);
+    }
+    return reg;
+}
@@ -0,0 +1,70 @@
+#include "orderBook_trace.hpp"
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+static const char TRACE_MAGIC[8] = {'O','B','T','R','A','C','E','\0'};
+static const uint32_t TRACE_VERSION = 2;
+
+bool TraceWriter::open(const std::string& path) {
+    close();
+    f_ = std::fopen(path.c_str(), "wb");
+    if (!f_) return false;
+    std::setvbuf(f_, nullptr, _IOFBF, 1 << 20);
+
+    TraceHeader h{};
+    std::memcpy(h.magic, TRACE_MAGIC, sizeof(h.magic));
+    h.version = TRACE_VERSION;
+    h.recordSize = sizeof(TraceRecord);
+    h.count = 0;
+    std::fwrite(&h, sizeof(h), 1, f_);
+    count_ = 0;
+    return true;
+}
+
+void TraceWriter::write(const TraceRecord& r) {
+    if (!f_) return;
+    std::fwrite(&r, sizeof(r), 1, f_);
+    ++count_;
+}
+
+void TraceWriter::write(const std::vector<TraceRecord>& rs) {
+    if (!f_ || rs.empty()) return;
+    std::fwrite(rs.data(), sizeof(TraceRecord), rs.size(), f_);
+    count_ += rs.size();
+}
+
+void TraceWriter::close() {
+    if (!f_) return;
+    std::fseek(f_, offsetof(TraceHeader, count), SEEK_SET);
+    std::fwrite(&count_, sizeof(count_), 1, f_);
+    std::fclose(f_);
+    f_ = nullptr;
+}
+
+void widenSymbols(TraceRecord* rs, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        rs[i].symbol = rs[i].reserved;   // v1 symbol bytes; v1's reserved word was 0
+        rs[i].reserved = 0;
+    }
+}
+
+std::vector<TraceRecord> loadTrace(const std::string& path) {
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) throw std::runtime_error("cannot open trace " + path);
+
+    TraceHeader h{};
+    if (std::fread(&h, sizeof(h), 1, f) != 1 ||
+        std::memcmp(h.magic, TRACE_MAGIC, sizeof(h.magic)) != 0 ||
+        (h.version != TRACE_VERSION && h.version != 1) || h.recordSize != sizeof(TraceRecord)) {
+        std::fclose(f);
+        throw std::runtime_error("bad trace header in " + path);
+    }
+
+    std::vector<TraceRecord> recs(h.count);
+    size_t got = recs.empty() ? 0 : std::fread(recs.data(), sizeof(TraceRecord), recs.size(), f);
+    std::fclose(f);
+    if (got != recs.size()) throw std::runtime_error("truncated trace " + path);
+    if (h.version == 1) widenSymbols(recs.data(), recs.size());
+    return recs;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// -------------------- Binary operation trace --------------------
+// File layout: TraceHeader followed by `count` fixed-size TraceRecords
+// (little-endian, as written by the host). Kept free of engine types so
+// every harness, whatever engine it embeds, can record the same format.
+
+enum class TraceOp : uint8_t { Add, Cancel, Modify, Ioc };
+
+struct TraceHeader {
+    char     magic[8];    // "OBTRACE"
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t count;
+};
+
+// Version 1 kept a 16-bit symbol in bytes 2-3; loaders widen it on read
+struct TraceRecord {
+    uint8_t  op;      // TraceOp
+    uint8_t  side;    // 0 = buy, 1 = sell
+    uint16_t reserved;
+    int32_t  px;
+    uint32_t qty;
+    uint32_t symbol;  // harness-defined symbol index (0 for single-book runs)
+    uint64_t id;
+};
+static_assert(sizeof(TraceRecord) == 24, "trace record layout");
+
+class TraceWriter {
+public:
+    TraceWriter() = default;
+    explicit TraceWriter(const std::string& path) { open(path); }
+    ~TraceWriter() { close(); }
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    bool open(const std::string& path);
+    void write(const TraceRecord& r);
+    void write(const std::vector<TraceRecord>& rs);
+    void close();   // patches the record count into the header
+
+    bool isOpen() const { return f_ != nullptr; }
+    uint64_t count() const { return count_; }
+
+private:
+    std::FILE* f_ = nullptr;
+    uint64_t count_ = 0;
+};
+
+// Move version-1 records' 16-bit symbol into the 32-bit field, in place
+void widenSymbols(TraceRecord* rs, size_t n);
+
+// Load a whole trace into memory; throws std::runtime_error on a bad file
+std::vector<TraceRecord> loadTrace(const std::string& path);
@@ -0,0 +1,139 @@
+#include "orderBook_workload.hpp"
+#include <algorithm>
+#include <cmath>
+
+// -------------------- Generator --------------------
+WorkloadGenerator::WorkloadGenerator(const WorkloadConfig& cfg)
+    : cfg_(cfg), rng_(cfg.seed), mid_(cfg.startMid), nextId_(cfg.firstId) {
+    double total = cfg_.addWeight + cfg_.modifyWeight + cfg_.iocWeight;
+    if (total <= 0) total = 1;
+    cumAdd_    = cfg_.addWeight / total;
+    cumModify_ = cumAdd_ + cfg_.modifyWeight / total;
+}
+
+Price WorkloadGenerator::distance() {
+    // Inverse-CDF of a discrete Pareto tail starting at 0
+    double u = 1.0 - rng_.uniform();
+    double d = std::pow(u, -1.0 / cfg_.tailAlpha) - 1.0;
+    return (Price)std::min(d, (double)cfg_.maxDistance);
+}
+
+Price WorkloadGenerator::passivePrice(Side s) {
+    Price d = distance();
+    Price px = (s == Side::Buy) ? mid_ - 1 - d : mid_ + 1 + d;
+    return std::max(px, cfg_.minPrice);
+}
+
+Quantity WorkloadGenerator::size() {
+    Quantity q;
+    switch (cfg_.sizeDist) {
+    case SizeDist::Fixed:
+        q = (Quantity)cfg_.meanQty;
+        break;
+    case SizeDist::Uniform:
+        q = cfg_.minQty + (Quantity)rng_.below(cfg_.maxQty - cfg_.minQty + 1);
+        break;
+    case SizeDist::Geometric:
+    default: {
+        double p = 1.0 / std::max(cfg_.meanQty, 1.0);
+        double u = 1.0 - rng_.uniform();
+        q = (p >= 1.0) ? 1 : 1 + (Quantity)(std::log(u) / std::log1p(-p));
+        break;
+    }
+    }
+    q = std::min(std::max(q, cfg_.minQty), cfg_.maxQty);
+    if (cfg_.lotSize > 1) q = std::max(cfg_.lotSize, q - q % cfg_.lotSize);
+    return q;
+}
+
+uint64_t WorkloadGenerator::lifetime() {
+    if (cfg_.meanLifetime <= 0) return UINT64_MAX - opIndex_;
+    double u = 1.0 - rng_.uniform();
+    return 1 + (uint64_t)(-std::log(u) * cfg_.meanLifetime);
+}
+
+void WorkloadGenerator::drift() {
+    if (rng_.uniform() >= cfg_.driftProb) return;
+    mid_ += (rng_.next() & 1) ? 1 : -1;
+    mid_ = std::max(mid_, (Price)(cfg_.minPrice + 1));
+}
+
+WorkloadOp WorkloadGenerator::next() {
+    ++opIndex_;
+    drift();
+
+    // Lifetime over: this op is the order's cancel
+    if (!live_.empty() && live_.top().expiry <= opIndex_) {
+        Live l = live_.top();
+        live_.pop();
+        return {OpType::Cancel, l.side, l.id, l.px, 0};
+    }
+
+    double u = rng_.uniform();
+    Side s = (rng_.next() & 1) ? Side::Buy : Side::Sell;
+
+    if (u >= cumAdd_ && u < cumModify_ && !live_.empty()) {
+        // Modify: re-place around the current mid with a fresh size
+        Live l = live_.top();
+        live_.pop();
+        l.px = passivePrice(l.side);
+        l.qty = size();
+        l.expiry = opIndex_ + lifetime();
+        live_.push(l);
+        return {OpType::Modify, l.side, l.id, l.px, l.qty};
+    }
+
+    if (u >= cumModify_) {
+        // Marketable: cross the touch, sometimes walking a few levels
+        Price d = distance();
+        Price px = (s == Side::Buy) ? mid_ + 1 + d : std::max(mid_ - 1 - d, cfg_.minPrice);
+        return {OpType::Ioc, s, nextId_++, px, size()};
+    }
+
+    Live l{opIndex_ + lifetime(), nextId_++, s, passivePrice(s), size()};
+    live_.push(l);
+    return {OpType::Add, l.side, l.id, l.px, l.qty};
+}
+
+std::vector<WorkloadOp> WorkloadGenerator::generate(size_t n) {
+    std::vector<WorkloadOp> ops;
+    ops.reserve(n);
+    for (size_t i = 0; i < n; ++i) ops.push_back(next());
+    return ops;
+}
+
+// -------------------- Engine adapter --------------------
+Trades applyOp(Orderbook& ob, const WorkloadOp& op) {
+    switch (op.type) {
+    case OpType::Add:
+        return ob.AddOrder(ob.MakeOrder(OrderType::GoodTillCancel, op.id, op.side, op.px, op.qty));
+    case OpType::Ioc:
+        return ob.AddOrder(ob.MakeOrder(OrderType::FillAndKill, op.id, op.side, op.px, op.qty));
+    case OpType::Modify:
+        return ob.ModifyOrder(op.id, op.px, op.qty);
+    case OpType::Cancel:
+    default:
+        ob.CancelOrder(op.id);
+        return {};
+    }
+}
+
+// -------------------- Trace conversion --------------------
+static_assert((int)OpType::Add == (int)TraceOp::Add && (int)OpType::Cancel == (int)TraceOp::Cancel &&
+              (int)OpType::Modify == (int)TraceOp::Modify && (int)OpType::Ioc == (int)TraceOp::Ioc,
+              "OpType and TraceOp must stay in sync");
+
+TraceRecord toTrace(const WorkloadOp& op, uint32_t symbol) {
+    TraceRecord r{};
+    r.op = (uint8_t)op.type;
+    r.side = (op.side == Side::Buy) ? 0 : 1;
+    r.symbol = symbol;
+    r.px = op.px;
+    r.qty = op.qty;
+    r.id = op.id;
+    return r;
+}
+
+WorkloadOp fromTrace(const TraceRecord& r) {
+    return {(OpType)r.op, r.side == 0 ? Side::Buy : Side::Sell, r.id, r.px, r.qty};
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include "orderBook_core.hpp"
+#include "orderBook_trace.hpp"
+#include "orderBook_rng.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <queue>
+
+// -------------------- Workload description --------------------
+enum class OpType : uint8_t { Add, Cancel, Modify, Ioc };
+enum class SizeDist : uint8_t { Fixed, Uniform, Geometric };
+
+struct WorkloadOp {
+    OpType   type;
+    Side     side;
+    OrderId  id;
+    Price    px;
+    Quantity qty;
+};
+
+struct WorkloadConfig {
+    uint64_t seed    = 1;
+    OrderId  firstId = 1;
+
+    // Mid price: random walk of one tick with probability driftProb per op
+    Price    startMid  = 100;
+    double   driftProb = 0.01;
+    Price    minPrice  = 1;
+
+    // Distance from the touch in ticks: P(d >= k) ~ (k + 1)^-tailAlpha
+    double   tailAlpha   = 1.5;
+    Price    maxDistance = 50;
+
+    // Op mix (weights, normalized internally). Cancels are not drawn: each
+    // resting order is cancelled when its lifetime runs out (below), so the
+    // cancel ratio is the share of adds that rest that long unfilled.
+    double addWeight    = 0.85;
+    double modifyWeight = 0.05;
+    double iocWeight    = 0.10;
+
+    // Order size
+    SizeDist sizeDist = SizeDist::Geometric;
+    Quantity minQty   = 1;
+    Quantity maxQty   = 100;
+    double   meanQty  = 20;   // Fixed / Geometric
+    Quantity lotSize  = 1;
+
+    // Resting-order lifetime in ops (exponential). An order is cancelled at
+    // the op its lifetime runs out, so resting times follow this
+    // distribution; 0 = orders rest until filled and nothing is cancelled.
+    // Modifies take the order due soonest and restart it.
+    double meanLifetime = 1000;
+};
+
+// -------------------- Generator --------------------
+// Produces a seeded, reproducible op stream. Cancels/modifies may target an
+// order that has already filled; the engine treats those as no-ops.
+class WorkloadGenerator {
+public:
+    explicit WorkloadGenerator(const WorkloadConfig& cfg = WorkloadConfig());
+
+    WorkloadOp next();
+
+    // Pre-generate n ops so generation cost stays out of timed sections
+    std::vector<WorkloadOp> generate(size_t n);
+
+    Price mid() const { return mid_; }
+
+private:
+    struct Live {
+        uint64_t expiry;
+        OrderId  id;
+        Side     side;
+        Price    px;
+        Quantity qty;
+        bool operator>(const Live& o) const { return expiry > o.expiry; }
+    };
+
+    Price    distance();
+    Price    passivePrice(Side s);
+    Quantity size();
+    uint64_t lifetime();
+    void     drift();
+
+    WorkloadConfig cfg_;
+    Xoshiro256 rng_;
+    double cumAdd_, cumModify_;             // op-mix thresholds in [0,1)
+    Price mid_;
+    OrderId nextId_;
+    uint64_t opIndex_ = 0;
+    std::priority_queue<Live, std::vector<Live>, std::greater<Live>> live_;
+};
+
+// Apply one op through the engine's public API
+Trades applyOp(Orderbook& ob, const WorkloadOp& op);
+
+// Conversions to/from the binary trace format
+TraceRecord toTrace(const WorkloadOp& op, uint32_t symbol = 0);
+WorkloadOp  fromTrace(const TraceRecord& r);